@@ -0,0 +1,109 @@
+#include "Benchmarks.h"
+
+#include "Arrowhead/Arena.h"
+#include "Arrowhead/ArenaString.h"
+#include "Arrowhead/ArenaVector.h"
+
+#include <cstdio>
+#include <string>
+
+namespace arwh
+{
+	static constexpr uint32_t FrameCount = 1000;
+	static constexpr uint32_t ElementsPerFrame = 10000;
+	static constexpr uint32_t StringsPerFrame = 1000;
+
+	static const char* s_Names[] = { "position", "velocity", "a_much_longer_component_name_that_doesnt_fit_inline", "mesh" };
+
+	// Each frame grows a vector from empty, copies and formats strings, and throws it all away
+	// again. The arena side gets everything back with a single Clear at the end of the frame
+	void RunArenaContainerBenchmarks()
+	{
+		{
+			Arena* arena = Arena::CreateReserved(256 * 1024 * 1024);
+			BenchmarkTimer timer("ArenaVector PushBack, " + std::to_string(FrameCount) + " frames");
+			for (uint32_t frame = 0; frame < FrameCount; frame++)
+			{
+				ArenaVector<uint64_t> values(arena);
+				for (uint32_t i = 0; i < ElementsPerFrame; i++)
+					values.PushBack(i * frame);
+				DoNotOptimize(values.Data());
+				arena->Clear();
+			}
+			timer.Trigger();
+			Arena::Dispose(arena);
+		}
+
+		{
+			BenchmarkTimer timer("std::vector push_back, " + std::to_string(FrameCount) + " frames");
+			for (uint32_t frame = 0; frame < FrameCount; frame++)
+			{
+				std::vector<uint64_t> values;
+				for (uint32_t i = 0; i < ElementsPerFrame; i++)
+					values.push_back(i * frame);
+				DoNotOptimize(values.data());
+			}
+		}
+
+		{
+			Arena* arena = Arena::CreateReserved(256 * 1024 * 1024);
+			BenchmarkTimer timer("ArenaString Copy and Format, " + std::to_string(FrameCount) + " frames");
+			for (uint32_t frame = 0; frame < FrameCount; frame++)
+			{
+				for (uint32_t i = 0; i < StringsPerFrame; i++)
+				{
+					ArenaString copy = ArenaString::Copy(arena, s_Names[i % 4]);
+					ArenaString formatted = ArenaString::Format(arena, "%s[%u]", s_Names[i % 4], i);
+					DoNotOptimize(copy);
+					DoNotOptimize(formatted);
+				}
+				arena->Clear();
+			}
+			timer.Trigger();
+			Arena::Dispose(arena);
+		}
+
+		{
+			BenchmarkTimer timer("std::string copy and snprintf, " + std::to_string(FrameCount) + " frames");
+			for (uint32_t frame = 0; frame < FrameCount; frame++)
+			{
+				for (uint32_t i = 0; i < StringsPerFrame; i++)
+				{
+					std::string copy = s_Names[i % 4];
+					char buffer[128];
+					int size = snprintf(buffer, sizeof(buffer), "%s[%u]", s_Names[i % 4], i);
+					std::string formatted(buffer, size);
+					DoNotOptimize(copy);
+					DoNotOptimize(formatted);
+				}
+			}
+		}
+
+		{
+			Arena* arena = Arena::CreateReserved(256 * 1024 * 1024);
+			BenchmarkTimer timer("ArenaStringBuilder, " + std::to_string(FrameCount) + " frames");
+			for (uint32_t frame = 0; frame < FrameCount; frame++)
+			{
+				ArenaStringBuilder builder(arena);
+				for (uint32_t i = 0; i < StringsPerFrame; i++)
+					builder << s_Names[i % 4] << ',';
+				ArenaString result = builder.ToString();
+				DoNotOptimize(result);
+				arena->Clear();
+			}
+			timer.Trigger();
+			Arena::Dispose(arena);
+		}
+
+		{
+			BenchmarkTimer timer("std::string append, " + std::to_string(FrameCount) + " frames");
+			for (uint32_t frame = 0; frame < FrameCount; frame++)
+			{
+				std::string result;
+				for (uint32_t i = 0; i < StringsPerFrame; i++)
+					result.append(s_Names[i % 4]).push_back(',');
+				DoNotOptimize(result);
+			}
+		}
+	}
+}
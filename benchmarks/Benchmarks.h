@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Arrowhead/Timer.h"
+
+#include <thread>
+#include <vector>
+
+#ifdef ARWH_MSVC
+#include <intrin.h>
+#endif
+
+namespace arwh
+{
+	using BenchmarkTimer = Timer<std::chrono::microseconds>;
+
+	// Runs the same function on threadCount threads at once and waits for all of them
+	template<typename Function>
+	void RunOnThreads(uint32_t threadCount, Function function)
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; i++)
+			threads.emplace_back(function, i);
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// Keeps the compiler from throwing away work whose result is never read
+	template<typename T>
+	inline void DoNotOptimize(const T& value)
+	{
+#ifdef ARWH_MSVC
+		static const void* volatile s_Sink;
+		s_Sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r"(&value) : "memory");
+#endif
+	}
+
+	void RunConcurrentArenaBenchmarks();
+	void RunArenaContainerBenchmarks();
+	void RunConcurrentPoolBenchmarks();
+	void RunSlotMapBenchmarks();
+	void RunRefBenchmarks();
+	void RunRefContainerBenchmarks();
+}
@@ -0,0 +1,54 @@
+#include "Benchmarks.h"
+
+#include "Arrowhead/Arena.h"
+#include "Arrowhead/ConcurrentArena.h"
+
+#include <algorithm>
+#include <string>
+
+namespace arwh
+{
+	static constexpr size_t ChunkSize = 1024 * 1024;
+	static constexpr size_t PushesPerThread = 1000000;
+	static constexpr size_t PushSize = 32;
+
+	void RunConcurrentArenaBenchmarks()
+	{
+		uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+		for (uint32_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+		{
+			std::string suffix = ", " + std::to_string(threadCount) + " threads, " + std::to_string(PushesPerThread) + " pushes each";
+
+			// Everyone fights over the same chunk cursor
+			{
+				ConcurrentArena arena(ChunkSize);
+				BenchmarkTimer timer("ConcurrentArena shared" + suffix);
+				RunOnThreads(threadCount, [&](uint32_t)
+				{
+					for (size_t i = 0; i < PushesPerThread; i++)
+					{
+						uint8_t* block = static_cast<uint8_t*>(arena.Push(PushSize));
+						block[0] = static_cast<uint8_t>(i);
+						DoNotOptimize(block);
+					}
+				});
+			}
+
+			// The uncontended baseline, same chunk size so both map about as much memory
+			{
+				BenchmarkTimer timer("Arena per thread" + suffix);
+				RunOnThreads(threadCount, [&](uint32_t)
+				{
+					Arena* arena = Arena::CreateChained(ChunkSize);
+					for (size_t i = 0; i < PushesPerThread; i++)
+					{
+						uint8_t* block = static_cast<uint8_t*>(arena->Push(PushSize));
+						block[0] = static_cast<uint8_t>(i);
+						DoNotOptimize(block);
+					}
+					Arena::Dispose(arena);
+				});
+			}
+		}
+	}
+}
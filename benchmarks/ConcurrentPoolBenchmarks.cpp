@@ -0,0 +1,91 @@
+#include "Benchmarks.h"
+
+#include "Arrowhead/ConcurrentArena.h"
+#include "Arrowhead/ConcurrentPoolAllocator.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace arwh
+{
+	static constexpr uint32_t PairCount = 2;
+	static constexpr uint32_t MessagesPerPair = 1000000;
+	static constexpr uint32_t ChannelSize = 1024;
+
+	struct Message
+	{
+		uint64_t Payload[8];
+	};
+
+	// Single producer single consumer ring, a null slot is an empty one
+	struct Channel
+	{
+		std::atomic<Message*> Slots[ChannelSize] = {};
+
+		void Send(uint32_t index, Message* message)
+		{
+			std::atomic<Message*>& slot = Slots[index % ChannelSize];
+			while (slot.load(std::memory_order_acquire) != nullptr)
+				std::this_thread::yield();
+			slot.store(message, std::memory_order_release);
+		}
+
+		Message* Receive(uint32_t index)
+		{
+			std::atomic<Message*>& slot = Slots[index % ChannelSize];
+			Message* message;
+			while ((message = slot.load(std::memory_order_acquire)) == nullptr)
+				std::this_thread::yield();
+			slot.store(nullptr, std::memory_order_release);
+			return message;
+		}
+	};
+
+	// Even threads produce and odd threads consume, so every message is freed on a different
+	// thread than the one that allocated it
+	template<typename Allocate, typename Free>
+	static void RunProducerConsumer(const std::string& name, Allocate allocate, Free free)
+	{
+		std::unique_ptr<Channel[]> channels(new Channel[PairCount]);
+
+		BenchmarkTimer timer(name + ", " + std::to_string(PairCount) + " pairs, " + std::to_string(MessagesPerPair) + " messages each");
+		RunOnThreads(PairCount * 2, [&](uint32_t thread)
+		{
+			Channel& channel = channels[thread / 2];
+			if (thread % 2 == 0)
+			{
+				for (uint32_t i = 0; i < MessagesPerPair; i++)
+				{
+					Message* message = allocate();
+					message->Payload[0] = i;
+					channel.Send(i, message);
+				}
+			}
+			else
+			{
+				for (uint32_t i = 0; i < MessagesPerPair; i++)
+				{
+					Message* message = channel.Receive(i);
+					DoNotOptimize(message->Payload[0]);
+					free(message);
+				}
+			}
+		});
+	}
+
+	void RunConcurrentPoolBenchmarks()
+	{
+		{
+			ConcurrentArena arena(1024 * 1024);
+			ConcurrentPoolAllocator<Message> pool;
+			RunProducerConsumer("ConcurrentPoolAllocator",
+				[&]() { return pool.Allocate(&arena); },
+				[&](Message* message) { pool.Free(message); });
+		}
+
+		RunProducerConsumer("new and delete",
+			[]() { return new Message(); },
+			[](Message* message) { delete message; });
+	}
+}
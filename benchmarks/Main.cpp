@@ -0,0 +1,16 @@
+#include "Benchmarks.h"
+
+#include "Arrowhead/Logger.h"
+
+int main()
+{
+	arwh::Logger::Init();
+
+	arwh::RunConcurrentArenaBenchmarks();
+	arwh::RunArenaContainerBenchmarks();
+	arwh::RunConcurrentPoolBenchmarks();
+	arwh::RunSlotMapBenchmarks();
+	arwh::RunRefBenchmarks();
+	arwh::RunRefContainerBenchmarks();
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include "Benchmarks.h"
+
+#include "Arrowhead/Ref.h"
+
+#include <string>
+
+namespace arwh
+{
+	static constexpr uint32_t CopiesPerThread = 10000000;
+	static constexpr uint32_t SharedThreadCount = 4;
+
+	template<typename Policy>
+	struct BenchmarkObject : BasicRefCount<Policy>
+	{
+		uint64_t Value = 0;
+	};
+
+	template<typename Policy>
+	static void CopyAndDestroy(const Ref<BenchmarkObject<Policy>>& object)
+	{
+		for (uint32_t i = 0; i < CopiesPerThread; i++)
+		{
+			Ref<BenchmarkObject<Policy>> copy = object;
+			DoNotOptimize(copy);
+		}
+	}
+
+	// Every copy is one increment and one decrement, all on the thread that made the object
+	template<typename Policy>
+	static void RunOwnerThreadBenchmark(const char* name)
+	{
+		Ref<BenchmarkObject<Policy>> object = Ref<BenchmarkObject<Policy>>::Create();
+		BenchmarkTimer timer(std::string(name) + " copy and destroy, " + std::to_string(CopiesPerThread) + " copies");
+		CopyAndDestroy<Policy>(object);
+	}
+
+	// The constructing thread keeps its reference while the others hammer the count, which
+	// for the biased policy means everybody but the owner is on the shared path
+	template<typename Policy>
+	static void RunSharedBenchmark(const char* name)
+	{
+		Ref<BenchmarkObject<Policy>> object = Ref<BenchmarkObject<Policy>>::Create();
+		BenchmarkTimer timer(std::string(name) + " copy and destroy, owner plus " + std::to_string(SharedThreadCount - 1) +
+			" threads, " + std::to_string(CopiesPerThread) + " copies each");
+		RunOnThreads(SharedThreadCount, [&](uint32_t thread)
+		{
+			if (thread == 0)
+				CopyAndDestroy<Policy>(object);
+			else
+			{
+				Ref<BenchmarkObject<Policy>> local = object;
+				CopyAndDestroy<Policy>(local);
+			}
+		});
+	}
+
+	void RunRefBenchmarks()
+	{
+		RunOwnerThreadBenchmark<AtomicRefPolicy>("Atomic Ref");
+		RunOwnerThreadBenchmark<LocalRefPolicy>("Local Ref");
+		RunOwnerThreadBenchmark<BiasedRefPolicy>("Biased Ref");
+
+		RunSharedBenchmark<AtomicRefPolicy>("Atomic Ref");
+		RunSharedBenchmark<BiasedRefPolicy>("Biased Ref");
+	}
+}
@@ -0,0 +1,101 @@
+#include "Benchmarks.h"
+
+#include "Arrowhead/Ref.h"
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+
+namespace arwh
+{
+	static constexpr uint32_t RefsPerRound = 100000;
+	static constexpr uint32_t RoundCount = 20;
+
+	struct Shape : RefCount
+	{
+		Shape(uint32_t id)
+			: Id(id) {}
+		virtual ~Shape() = default;
+
+		uint32_t Id;
+	};
+
+	struct Circle : Shape
+	{
+		using Shape::Shape;
+	};
+
+	// Declaring the copy constructor drops the implicit move, so every reallocation, sort
+	// swap and erase goes through an increment and a decrement like Ref did before it moved
+	struct CopyOnlyRef
+	{
+		CopyOnlyRef(const Ref<Shape>& value)
+			: Value(value) {}
+		CopyOnlyRef(const CopyOnlyRef& other)
+			: Value(other.Value) {}
+		CopyOnlyRef& operator=(const CopyOnlyRef& other)
+		{
+			Value = other.Value;
+			return *this;
+		}
+
+		Ref<Shape> Value;
+	};
+
+	template<typename Element>
+	static const Shape* GetShape(const Element& element)
+	{
+		if constexpr (std::is_same<Element, CopyOnlyRef>::value)
+			return element.Value.Raw();
+		else
+			return element.Raw();
+	}
+
+	// Grows the vector from empty, sorts it and erases the even ids
+	template<typename Element>
+	static void RunContainerRound(const std::vector<Ref<Shape>>& shapes)
+	{
+		std::vector<Element> elements;
+		for (const Ref<Shape>& shape : shapes)
+			elements.push_back(shape);
+
+		std::sort(elements.begin(), elements.end(), [](const Element& a, const Element& b) { return GetShape(a)->Id > GetShape(b)->Id; });
+
+		elements.erase(std::remove_if(elements.begin(), elements.end(), [](const Element& element) { return GetShape(element)->Id % 2 == 0; }), elements.end());
+		DoNotOptimize(elements.data());
+	}
+
+	void RunRefContainerBenchmarks()
+	{
+		std::vector<Ref<Shape>> shapes;
+		shapes.reserve(RefsPerRound);
+		for (uint32_t i = 0; i < RefsPerRound; i++)
+			shapes.push_back(Ref<Shape>::Create(i));
+
+		std::string suffix = ", " + std::to_string(RefsPerRound) + " refs, " + std::to_string(RoundCount) + " rounds";
+
+		{
+			BenchmarkTimer timer("std::vector<Ref> grow, sort and erase" + suffix);
+			for (uint32_t round = 0; round < RoundCount; round++)
+				RunContainerRound<Ref<Shape>>(shapes);
+		}
+
+		{
+			BenchmarkTimer timer("std::vector of copy only refs grow, sort and erase" + suffix);
+			for (uint32_t round = 0; round < RoundCount; round++)
+				RunContainerRound<CopyOnlyRef>(shapes);
+		}
+
+		// Upcasting on the way in, which is a converting move rather than a copy
+		{
+			BenchmarkTimer timer("std::vector<Ref<Shape>> filled from Ref<Circle>, " + std::to_string(RefsPerRound) + " refs, " + std::to_string(RoundCount) + " rounds");
+			for (uint32_t round = 0; round < RoundCount; round++)
+			{
+				std::vector<Ref<Shape>> circles;
+				for (uint32_t i = 0; i < RefsPerRound; i++)
+					circles.push_back(Ref<Circle>::Create(i));
+				DoNotOptimize(circles.data());
+			}
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#include "Benchmarks.h"
+
+#include "Arrowhead/Arena.h"
+#include "Arrowhead/SlotMap.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+namespace arwh
+{
+	static constexpr uint32_t EntityCount = 100000;
+	static constexpr uint32_t PassCount = 100;
+
+	struct Particle
+	{
+		float Position[3];
+		float Velocity[3];
+	};
+
+	// Both sides go through the same churn first, erasing a random half and inserting it again,
+	// so the pool hands out recycled nodes in shuffled order the way it would in a live scene
+	void RunSlotMapBenchmarks()
+	{
+		std::mt19937 random(1234);
+		std::vector<uint32_t> order(EntityCount);
+		for (uint32_t i = 0; i < EntityCount; i++)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), random);
+
+		std::string suffix = ", " + std::to_string(EntityCount) + " particles, " + std::to_string(PassCount) + " passes";
+
+		Arena* arena = Arena::CreateReserved(256 * 1024 * 1024);
+
+		SlotMap<Particle> particles(arena);
+		std::vector<SlotHandle> handles(EntityCount);
+		for (uint32_t i = 0; i < EntityCount; i++)
+			handles[i] = particles.Insert(Particle{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 3.0f } });
+		for (uint32_t i = 0; i < EntityCount / 2; i++)
+			particles.Erase(handles[order[i]]);
+		for (uint32_t i = 0; i < EntityCount / 2; i++)
+			handles[order[i]] = particles.Insert(Particle{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 3.0f } });
+
+		PoolArenaAllocator<Particle> pool;
+		std::vector<Particle*> pointers(EntityCount);
+		for (uint32_t i = 0; i < EntityCount; i++)
+			pointers[i] = pool.Allocate(arena, Particle{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 3.0f } });
+		for (uint32_t i = 0; i < EntityCount / 2; i++)
+			pool.Free(pointers[order[i]]);
+		for (uint32_t i = 0; i < EntityCount / 2; i++)
+			pointers[order[i]] = pool.Allocate(arena, Particle{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 3.0f } });
+
+		{
+			BenchmarkTimer timer("SlotMap iteration" + suffix);
+			for (uint32_t pass = 0; pass < PassCount; pass++)
+			{
+				for (Particle& particle : particles)
+				{
+					for (uint32_t axis = 0; axis < 3; axis++)
+						particle.Position[axis] += particle.Velocity[axis];
+				}
+				DoNotOptimize(particles.begin());
+			}
+		}
+
+		{
+			BenchmarkTimer timer("PoolArenaAllocator pointer iteration" + suffix);
+			for (uint32_t pass = 0; pass < PassCount; pass++)
+			{
+				for (Particle* particle : pointers)
+				{
+					for (uint32_t axis = 0; axis < 3; axis++)
+						particle->Position[axis] += particle->Velocity[axis];
+				}
+				DoNotOptimize(pointers.data());
+			}
+		}
+
+		// Random lookups, where the handle has to go through the slot table first
+		{
+			BenchmarkTimer timer("SlotMap random Get" + suffix);
+			for (uint32_t pass = 0; pass < PassCount; pass++)
+			{
+				for (uint32_t index : order)
+					particles.Get(handles[index])->Position[0] += 1.0f;
+				DoNotOptimize(particles.begin());
+			}
+		}
+
+		{
+			BenchmarkTimer timer("PoolArenaAllocator random pointer access" + suffix);
+			for (uint32_t pass = 0; pass < PassCount; pass++)
+			{
+				for (uint32_t index : order)
+					pointers[index]->Position[0] += 1.0f;
+				DoNotOptimize(pointers.data());
+			}
+		}
+
+		Arena::Dispose(arena);
+	}
+}
@@ -1,12 +1,45 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
 #include <utility>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
 
 namespace arwh
 {
+	enum class ArenaMode
+	{
+		Fixed,		// One malloc'd block, pushing past the end is an error
+		Reserved,	// Reserved address range that gets committed as the arena grows
+		Chained		// Links new malloc'd blocks onto the arena when it runs out of space
+	};
+
+	enum class ArenaBacking
+	{
+		Heap,					// Plain malloc
+		Pages,					// Memory mapped straight from the system
+		TransparentHugePages,	// Mapped and advised to use transparent huge pages
+		HugeTLB					// Mapped out of the explicit huge page pool
+	};
+
+	// Usage numbers for one arena. Everything past Capacity is only tracked when the
+	// library is built with ARWH_ARENA_STATS and stays zero otherwise
+	struct ArenaStats
+	{
+		const char* Name;
+		ArenaMode Mode;
+		ArenaBacking Backing;
+		size_t Capacity;
+		size_t Position;
+		size_t PeakPosition;
+		uint64_t PushCount;
+		uint64_t GrowCount;
+	};
+
 	class Arena
 	{
 	public:
@@ -22,55 +55,218 @@ namespace arwh
 
 		void* PushZero(size_t size);
 
+		// Pads the position up to alignment first, which has to be a power of two
+		void* PushAligned(size_t size, size_t alignment);
+		void* PushAlignedZero(size_t size, size_t alignment);
+
 		template<typename T>
 		T* PushArray(uint64_t count)
 		{
-			return reinterpret_cast<T*>(Push(sizeof(T) * count));
+			return reinterpret_cast<T*>(PushAligned(sizeof(T) * count, alignof(T)));
 		}
 
 		template<typename T>
 		T* PushArrayZero(size_t count)
 		{
-			return reinterpret_cast<T*>(PushZero(sizeof(T) * count));
+			return reinterpret_cast<T*>(PushAlignedZero(sizeof(T) * count, alignof(T)));
 		}
 
 		template<typename T>
 		T* PushStruct()
 		{
-			return reinterpret_cast<T*>(Push(sizeof(T)));
+			return reinterpret_cast<T*>(PushAligned(sizeof(T), alignof(T)));
 		}
 
 		template<typename T>
 		T* PushStructZero()
 		{
-			return reinterpret_cast<T*>(PushZero(sizeof(T)));
+			return reinterpret_cast<T*>(PushAlignedZero(sizeof(T), alignof(T)));
+		}
+
+		// Constructing helpers. Types that aren't trivially destructible also get their
+		// destructors run when the arena is popped back past them or cleared
+
+		template<typename T, typename... Args>
+		T* New(Args&&... args)
+		{
+			if constexpr (!std::is_trivially_destructible<T>::value)
+			{
+				Destructor* destructor = PushStruct<Destructor>();
+				T* value = new(PushStruct<T>()) T(std::forward<Args>(args)...);
+				AddDestructor(destructor, &DestroyObjects<T>, value, 1);
+				return value;
+			}
+			else
+				return new(PushStruct<T>()) T(std::forward<Args>(args)...);
+		}
+
+		template<typename T, typename... Args>
+		T* NewArray(size_t count, const Args&... args)
+		{
+			Destructor* destructor = nullptr;
+			if constexpr (!std::is_trivially_destructible<T>::value)
+				destructor = PushStruct<Destructor>();
+
+			T* values = PushArray<T>(count);
+			for (size_t i = 0; i < count; i++)
+				new(values + i) T(args...);
+
+			if constexpr (!std::is_trivially_destructible<T>::value)
+				AddDestructor(destructor, &DestroyObjects<T>, values, count);
+			return values;
 		}
 
-		// Popping helpers
+		static constexpr size_t CacheLineSize = 64;
+
+		static constexpr uint32_t MaxScratchCount = 8;
+		static constexpr uint32_t DefaultScratchCount = 2;
+		static constexpr size_t DefaultScratchSize = 1024 * 1024;
+
+		// Popping helpers. Passing release gives the memory past the new position
+		// back to the system when the arena is able to
 
 		size_t GetPos() const { return m_AllocatedSize; };
-		void SetPosBack(size_t pos);
-		void Clear();
 
-		inline static Arena* Create(size_t size);
-		inline static void Dispose(Arena* arena) { free(arena); }
+		// Whether the block is the last thing that was pushed, in which case it can be popped
+		inline bool IsLast(const void* block, size_t size) const { return static_cast<const uint8_t*>(block) + size == m_Position; }
+
+		// Grows the last block in place to newSize, returns false if it isn't the last block
+		// or the arena can't make room for it without moving it
+		bool Extend(void* block, size_t size, size_t newSize);
+
+		void SetPosBack(size_t pos, bool release = false);
+		void Clear(bool release = false);
+
+		// A chained arena stops being contiguous once it links its first extra block on
+		inline bool IsContiguous() const { return m_Block == nullptr; }
+		inline const uint8_t* GetData() const { return reinterpret_cast<const uint8_t*>(this + 1); }
+
+		inline ArenaMode GetMode() const { return m_Mode; }
+		inline size_t GetCapacity() const { return m_TotalSize; }
+
+		// The backing that was actually obtained, which can be a step down from the one asked for
+		inline ArenaBacking GetBacking() const { return m_Backing; }
+
+		// Backings other than Heap round the capacity up to the page size they end up
+		// with. HugeTLB falls back to TransparentHugePages, which falls back to Pages
+		static Arena* Create(size_t size, ArenaBacking backing = ArenaBacking::Heap);
+
+		// Reserves reserveSize bytes of address space up front and commits them in
+		// commitSize steps, so the arena never moves and only uses what it touches
+		static Arena* CreateReserved(size_t reserveSize, size_t commitSize = DefaultCommitSize);
+
+		// Starts with one blockSize block and links another one on whenever a push doesn't
+		// fit, for when reserving a big address range isn't an option
+		static Arena* CreateChained(size_t blockSize);
+		static void Dispose(Arena* arena);
 
-		static void InitScratch();
-		inline static void DisposeScratch() { Dispose(s_TempScratch); Dispose(s_PersistentScratch); }
+		// Every thread gets its own pool of count scratch arenas
+		static void InitScratch(ArenaBacking backing = ArenaBacking::Heap, uint32_t count = DefaultScratchCount, size_t size = DefaultScratchSize);
+		static void DisposeScratch();
 
-		static Arena* GetTempScratch() { return s_TempScratch; }
-		static Arena* GetPersistentScratch() { return s_PersistentScratch; }
+		// Picks a scratch arena that isn't any of the conflicts. Pass in the arenas a function
+		// is returning data in so the scratch memory it uses can't clobber them
+		template<typename... Conflicts>
+		static Arena* GetScratch(Conflicts*... conflicts)
+		{
+			Arena* conflictList[] = { conflicts..., nullptr };
+			return GetScratchExcluding(conflictList, sizeof...(Conflicts));
+		}
+
+		static Arena* GetTempScratch() { return s_Scratch[0]; }
+		static Arena* GetPersistentScratch() { return s_Scratch[1]; }
+
+		static constexpr size_t DefaultCommitSize = 64 * 1024;
+
+		// Telemetry, the counters only move when the library is built with ARWH_ARENA_STATS
+
+		inline void SetName(const char* name) { m_Name.store(name, std::memory_order_relaxed); }
+		inline const char* GetName() const { return m_Name.load(std::memory_order_relaxed); }
+		ArenaStats GetStats() const;
+
+		// Stats for every arena that is alive right now on any thread, scratch arenas included
+		static std::vector<ArenaStats> GetLiveStats();
+		static void LogLiveStats();
 
 	private:
-		Arena(size_t size);
+		// Header at the start of every block a chained arena links on after the first one
+		struct Block
+		{
+			Block* Prev;
+			size_t BasePos;
+			size_t Size;
+
+			inline uint8_t* GetData() { return reinterpret_cast<uint8_t*>(this + 1); }
+		};
+
+		// Node in the list of objects that need to be destroyed when they get popped
+		struct Destructor
+		{
+			Destructor* Next;
+			void (*Destroy)(void*, size_t);
+			void* Objects;
+			size_t Count;
+			size_t EndPos;
+		};
+
+		template<typename T>
+		static void DestroyObjects(void* objects, size_t count)
+		{
+			// Destroy in reverse order like delete[] does
+			T* values = static_cast<T*>(objects);
+			for (size_t i = count; i > 0; i--)
+				values[i - 1].~T();
+		}
+
+		Arena(size_t size, ArenaMode mode);
+
+		void Grow(size_t size, size_t alignment);
+		void PushBlock(size_t size);
+		void PopBlock(bool release);
+
+		static Arena* GetScratchExcluding(Arena* const* conflicts, size_t conflictCount);
+
+		void AddDestructor(Destructor* destructor, void (*destroy)(void*, size_t), void* objects, size_t count);
+		void RunDestructors(size_t pos);
 
 		uint8_t* m_Data;
 		uint8_t* m_Position;
+		uint8_t* m_End;
 		size_t m_TotalSize;
 		size_t m_AllocatedSize = 0;
 
-		inline static thread_local Arena* s_TempScratch = nullptr;
-		inline static thread_local Arena* s_PersistentScratch = nullptr;
+		ArenaMode m_Mode;
+		ArenaBacking m_Backing = ArenaBacking::Heap;
+		size_t m_CommitSize = 0;
+
+		// Chained mode state, the first block is the one after the arena structure
+		Block* m_Block = nullptr;
+		Block* m_FreeBlocks = nullptr;
+		size_t m_BlockBase = 0;
+
+		Destructor* m_Destructors = nullptr;
+
+		void Register();
+		void Unregister();
+		void PublishPosition();
+		ArenaStats GetPublishedStats() const;
+
+		// Always part of the layout so code built without ARWH_ARENA_STATS still agrees
+		// with the library on the size of an Arena, the data starts right after it. Only
+		// the owning thread writes these, they're atomic so GetLiveStats can read them from
+		// any other thread
+		std::atomic<const char*> m_Name = "Unnamed";
+		std::atomic<size_t> m_PublishedSize = 0;
+		std::atomic<size_t> m_PeakSize = 0;
+		std::atomic<uint64_t> m_PushCount = 0;
+		std::atomic<uint64_t> m_GrowCount = 0;
+
+		// Links in the list of live arenas
+		Arena* m_PrevLive = nullptr;
+		Arena* m_NextLive = nullptr;
+
+		inline static thread_local Arena* s_Scratch[MaxScratchCount] = {};
+		inline static thread_local uint32_t s_ScratchCount = 0;
 	};
 
 	template<typename T>
@@ -94,14 +290,45 @@ namespace arwh
 				node->Next = nullptr;
 			}
 			else // Otherwise allocate a new one from the specified arena
-				node = arena->PushStructZero<Node>();
+				node = arena->PushStruct<Node>();
 
-			// Initialize the stored structure and return it
-			node->Value = T(std::forward<args>(args)...);
-			return &node->Value;
+			// Construct the stored structure in place, value initializing it zeroes trivial
+			// types when there are no arguments so the node doesn't have to be cleared first
+			return new(&node->Value) T(std::forward<Args>(args)...);
+		}
+
+		// Fills values with count new objects, taking from the free list first and carving
+		// whatever is left out of the arena with a single push
+		template<typename... Args>
+		void AllocateBatch(Arena* arena, T** values, size_t count, const Args&... args)
+		{
+			size_t i = 0;
+			for (; i < count && m_FirstFree != nullptr; i++)
+			{
+				Node* node = m_FirstFree;
+				m_FirstFree = node->Next;
+				values[i] = &node->Value;
+			}
+
+			if (i < count)
+			{
+				Node* nodes = arena->PushArray<Node>(count - i);
+				for (size_t j = 0; i < count; i++, j++)
+					values[i] = &nodes[j].Value;
+			}
+
+			for (i = 0; i < count; i++)
+				new(values[i]) T(args...);
 		}
 
 		void Free(T* value)
+		{
+			value->~T();
+			FreeDestroyed(value);
+		}
+
+		// Takes back a node whose value has already been destroyed
+		void FreeDestroyed(T* value)
 		{
 			// Cast the pointer up to a node and add it to the beginning of the free list
 			Node* node = reinterpret_cast<Node*>(value);
@@ -109,14 +336,40 @@ namespace arwh
 			m_FirstFree = node;
 		}
 
+		void FreeBatch(T* const* values, size_t count)
+		{
+			if (count == 0)
+				return;
+
+			// Link the nodes together first and then splice the whole chain onto the free list
+			for (size_t i = 0; i < count; i++)
+			{
+				values[i]->~T();
+				reinterpret_cast<Node*>(values[i])->Next = i + 1 < count ? reinterpret_cast<Node*>(values[i + 1]) : m_FirstFree;
+			}
+			m_FirstFree = reinterpret_cast<Node*>(values[0]);
+		}
+
 	private:
 		Node* m_FirstFree = nullptr;
 	};
 
+	// Remembers the position of an arena and sets it back there when it goes out of scope
 	class ScratchSpace
 	{
 	public:
 		ScratchSpace(Arena* arena);
+		~ScratchSpace();
+
+		ScratchSpace(const ScratchSpace&) = delete;
+		ScratchSpace& operator=(const ScratchSpace&) = delete;
+
+		// Opens a scope on a scratch arena that isn't any of the conflicts
+		template<typename... Conflicts>
+		static ScratchSpace Get(Conflicts*... conflicts)
+		{
+			return ScratchSpace(Arena::GetScratch(conflicts...));
+		}
 
 		void Reset();
 
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Arrowhead/Arena.h"
+#include "Arrowhead/SizeClassAllocator.h"
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace arwh
+{
+	// Memory resource for the std::pmr containers that pushes everything onto an arena.
+	// Deallocating pops the block if it's the last one on the arena and is a no-op otherwise,
+	// everything else gets freed when the arena is set back or cleared
+	class ArenaResource : public std::pmr::memory_resource
+	{
+	public:
+		ArenaResource(Arena* arena)
+			: m_Arena(arena) {}
+
+		ArenaResource(ScratchSpace& scratch)
+			: m_Arena(scratch.GetArena()) {}
+
+		inline Arena* GetArena() const { return m_Arena; }
+
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			return m_Arena->PushAligned(bytes, alignment);
+		}
+
+		virtual void do_deallocate(void* block, size_t bytes, size_t) override
+		{
+			if (m_Arena->IsLast(block, bytes))
+				m_Arena->Pop(bytes);
+		}
+
+		virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			// Resources over the same arena can free each other's memory
+			const ArenaResource* resource = dynamic_cast<const ArenaResource*>(&other);
+			return resource != nullptr && resource->m_Arena == m_Arena;
+		}
+
+	private:
+		Arena* m_Arena;
+	};
+
+	// Memory resource that actually reuses freed memory by going through a size class allocator
+	class SizeClassResource : public std::pmr::memory_resource
+	{
+	public:
+		SizeClassResource(SizeClassAllocator* allocator)
+			: m_Allocator(allocator) {}
+
+		inline SizeClassAllocator* GetAllocator() const { return m_Allocator; }
+
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			return m_Allocator->Allocate(bytes, alignment);
+		}
+
+		virtual void do_deallocate(void* block, size_t bytes, size_t alignment) override
+		{
+			m_Allocator->Free(block, bytes, alignment);
+		}
+
+		virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			const SizeClassResource* resource = dynamic_cast<const SizeClassResource*>(&other);
+			return resource != nullptr && resource->m_Allocator == m_Allocator;
+		}
+
+	private:
+		SizeClassAllocator* m_Allocator;
+	};
+
+	// Same idea as ArenaResource but as a classic allocator for containers that don't use pmr
+	template<typename T>
+	class ArenaAllocator
+	{
+	public:
+		using value_type = T;
+
+		ArenaAllocator(Arena* arena) noexcept
+			: m_Arena(arena) {}
+
+		ArenaAllocator(ScratchSpace& scratch) noexcept
+			: m_Arena(scratch.GetArena()) {}
+
+		template<typename J>
+		ArenaAllocator(const ArenaAllocator<J>& other) noexcept
+			: m_Arena(other.GetArena()) {}
+
+		T* allocate(size_t count)
+		{
+			return reinterpret_cast<T*>(m_Arena->PushAligned(sizeof(T) * count, alignof(T)));
+		}
+
+		void deallocate(T* block, size_t count)
+		{
+			if (m_Arena->IsLast(block, sizeof(T) * count))
+				m_Arena->Pop(sizeof(T) * count);
+		}
+
+		inline Arena* GetArena() const { return m_Arena; }
+
+		template<typename J>
+		bool operator==(const ArenaAllocator<J>& other) const { return m_Arena == other.GetArena(); }
+		template<typename J>
+		bool operator!=(const ArenaAllocator<J>& other) const { return m_Arena != other.GetArena(); }
+
+	private:
+		Arena* m_Arena;
+	};
+}
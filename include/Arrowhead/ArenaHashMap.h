@@ -0,0 +1,339 @@
+#pragma once
+
+#include "Arrowhead/Arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARWH_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace arwh
+{
+	// Open addressing hash map with all of its memory on an arena. The layout follows
+	// SwissTable: one control byte per slot holding 7 bits of the hash, probed 16 slots
+	// at a time, with the slots themselves in a separate array. Growing rehashes into a
+	// new region of the arena and leaves the old one behind to be cleared with the arena
+	template<typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+	class ArenaHashMap
+	{
+	public:
+		struct Slot
+		{
+			K Key;
+			V Value;
+		};
+
+		ArenaHashMap(Arena* arena)
+			: m_Arena(arena) {}
+
+		ArenaHashMap(Arena* arena, size_t capacity)
+			: m_Arena(arena)
+		{
+			Reserve(capacity);
+		}
+
+		ArenaHashMap(const ArenaHashMap&) = delete;
+		ArenaHashMap& operator=(const ArenaHashMap&) = delete;
+
+		~ArenaHashMap()
+		{
+			DestroySlots();
+		}
+
+		V* Find(const K& key)
+		{
+			size_t index = FindIndex(key);
+			return index != NotFound ? &m_Slots[index].Value : nullptr;
+		}
+
+		const V* Find(const K& key) const
+		{
+			size_t index = FindIndex(key);
+			return index != NotFound ? &m_Slots[index].Value : nullptr;
+		}
+
+		bool Contains(const K& key) const { return Find(key) != nullptr; }
+
+		// Returns the value for the key and whether it was newly inserted
+		template<typename... Args>
+		std::pair<V*, bool> Emplace(const K& key, Args&&... args)
+		{
+			if (V* value = Find(key))
+				return { value, false };
+
+			// Rehashing at the same capacity is enough when it's mostly tombstones filling the table
+			if (m_Size + m_Deleted + 1 > GetMaxLoad(m_Capacity))
+			{
+				size_t capacity = GetCapacityFor(m_Size + 1);
+				Rehash(capacity > m_Capacity ? std::max(capacity, m_Capacity * 2) : m_Capacity);
+			}
+
+			size_t hash = HashKey(key);
+			size_t index = FindInsertIndex(hash);
+			if (m_Control[index] == Deleted)
+				m_Deleted--;
+			m_Control[index] = GetH2(hash);
+
+			Slot* slot = m_Slots + index;
+			new(&slot->Key) K(key);
+			new(&slot->Value) V(std::forward<Args>(args)...);
+			m_Size++;
+			return { &slot->Value, true };
+		}
+
+		std::pair<V*, bool> Insert(const K& key, const V& value) { return Emplace(key, value); }
+
+		V& operator[](const K& key) { return *Emplace(key).first; }
+
+		// Reserves room for everything up front so the whole batch goes in without rehashing
+		void InsertBulk(const K* keys, const V* values, size_t count)
+		{
+			Reserve(m_Size + count);
+			for (size_t i = 0; i < count; i++)
+				Emplace(keys[i], values[i]);
+		}
+
+		bool Erase(const K& key)
+		{
+			size_t index = FindIndex(key);
+			if (index == NotFound)
+				return false;
+
+			DestroySlot(m_Slots[index]);
+
+			// Probes never get past a group with an empty slot in it, so the slot can go
+			// straight back to empty in that case instead of leaving a tombstone
+			Group control(m_Control + (index & ~(GroupSize - 1)));
+			if (control.MatchEmpty() != 0)
+				m_Control[index] = Empty;
+			else
+			{
+				m_Control[index] = Deleted;
+				m_Deleted++;
+			}
+
+			m_Size--;
+			return true;
+		}
+
+		void Reserve(size_t count)
+		{
+			size_t capacity = GetCapacityFor(count);
+			if (capacity > m_Capacity)
+				Rehash(capacity);
+		}
+
+		// Moves everything into a new region of the arena with the given capacity, which has
+		// to be a power of two that is at least GroupSize and can fit everything in the map
+		void Rehash(size_t capacity)
+		{
+			int8_t* oldControl = m_Control;
+			Slot* oldSlots = m_Slots;
+			size_t oldCapacity = m_Capacity;
+
+			m_Control = reinterpret_cast<int8_t*>(m_Arena->PushAligned(capacity, GroupSize));
+			m_Slots = m_Arena->PushArray<Slot>(capacity);
+			m_Capacity = capacity;
+			m_Deleted = 0;
+			memset(m_Control, Empty, capacity);
+
+			for (size_t i = 0; i < oldCapacity; i++)
+			{
+				if (oldControl[i] < 0)
+					continue;
+
+				Slot& oldSlot = oldSlots[i];
+				size_t hash = HashKey(oldSlot.Key);
+				size_t index = FindInsertIndex(hash);
+				m_Control[index] = GetH2(hash);
+
+				new(&m_Slots[index].Key) K(std::move(oldSlot.Key));
+				new(&m_Slots[index].Value) V(std::move(oldSlot.Value));
+				DestroySlot(oldSlot);
+			}
+		}
+
+		void Clear()
+		{
+			DestroySlots();
+			if (m_Capacity > 0)
+				memset(m_Control, Empty, m_Capacity);
+			m_Size = 0;
+			m_Deleted = 0;
+		}
+
+		template<typename Fn>
+		void ForEach(Fn&& fn)
+		{
+			for (size_t i = 0; i < m_Capacity; i++)
+				if (m_Control[i] >= 0)
+					fn(m_Slots[i].Key, m_Slots[i].Value);
+		}
+
+		inline size_t GetSize() const { return m_Size; }
+		inline size_t GetCapacity() const { return m_Capacity; }
+		inline bool IsEmpty() const { return m_Size == 0; }
+
+		static constexpr size_t GroupSize = 16;
+
+	private:
+		// Control bytes are either one of these or the 7 bit hash of a full slot
+		static constexpr int8_t Empty = -128;
+		static constexpr int8_t Deleted = -2;
+
+		struct Group
+		{
+#ifdef ARWH_SSE2
+			__m128i Control;
+
+			Group(const int8_t* control)
+				: Control(_mm_load_si128(reinterpret_cast<const __m128i*>(control))) {}
+
+			uint32_t Match(int8_t h2) const
+			{
+				return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), Control)));
+			}
+
+			uint32_t MatchEmpty() const { return Match(Empty); }
+
+			// Empty and deleted are the only control bytes with the sign bit set
+			uint32_t MatchEmptyOrDeleted() const { return static_cast<uint32_t>(_mm_movemask_epi8(Control)); }
+#else
+			const int8_t* Control;
+
+			Group(const int8_t* control)
+				: Control(control) {}
+
+			uint32_t Match(int8_t h2) const
+			{
+				uint32_t mask = 0;
+				for (uint32_t i = 0; i < GroupSize; i++)
+					mask |= static_cast<uint32_t>(Control[i] == h2) << i;
+				return mask;
+			}
+
+			uint32_t MatchEmpty() const { return Match(Empty); }
+
+			uint32_t MatchEmptyOrDeleted() const
+			{
+				uint32_t mask = 0;
+				for (uint32_t i = 0; i < GroupSize; i++)
+					mask |= static_cast<uint32_t>(Control[i] < 0) << i;
+				return mask;
+			}
+#endif
+		};
+
+		static constexpr size_t NotFound = ~static_cast<size_t>(0);
+
+		size_t FindIndex(const K& key) const
+		{
+			if (m_Capacity == 0)
+				return NotFound;
+
+			size_t hash = HashKey(key);
+			int8_t h2 = GetH2(hash);
+
+			size_t groupMask = m_Capacity / GroupSize - 1;
+			size_t group = GetH1(hash) & groupMask;
+			for (size_t probe = 1; ; probe++)
+			{
+				Group control(m_Control + group * GroupSize);
+				for (uint32_t match = control.Match(h2); match != 0; match &= match - 1)
+				{
+					size_t index = group * GroupSize + CountTrailingZeros(match);
+					if (Equal()(m_Slots[index].Key, key))
+						return index;
+				}
+
+				// An empty slot means the key would have been put here if it existed
+				if (control.MatchEmpty() != 0)
+					return NotFound;
+
+				group = (group + probe) & groupMask;
+			}
+		}
+
+		size_t FindInsertIndex(size_t hash) const
+		{
+			size_t groupMask = m_Capacity / GroupSize - 1;
+			size_t group = GetH1(hash) & groupMask;
+			for (size_t probe = 1; ; probe++)
+			{
+				uint32_t match = Group(m_Control + group * GroupSize).MatchEmptyOrDeleted();
+				if (match != 0)
+					return group * GroupSize + CountTrailingZeros(match);
+
+				group = (group + probe) & groupMask;
+			}
+		}
+
+		void DestroySlot(Slot& slot)
+		{
+			if constexpr (!std::is_trivially_destructible<K>::value)
+				slot.Key.~K();
+			if constexpr (!std::is_trivially_destructible<V>::value)
+				slot.Value.~V();
+		}
+
+		void DestroySlots()
+		{
+			if constexpr (!std::is_trivially_destructible<K>::value || !std::is_trivially_destructible<V>::value)
+			{
+				for (size_t i = 0; i < m_Capacity; i++)
+					if (m_Control[i] >= 0)
+						DestroySlot(m_Slots[i]);
+			}
+		}
+
+		static size_t HashKey(const K& key)
+		{
+			// Mix the hash since std::hash is the identity for integers on some platforms
+			uint64_t hash = static_cast<uint64_t>(Hash()(key)) * 0x9E3779B97F4A7C15ull;
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+
+		static inline size_t GetH1(size_t hash) { return hash >> 7; }
+		static inline int8_t GetH2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+		// Keep the table at most 7/8 full
+		static inline size_t GetMaxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+		static size_t GetCapacityFor(size_t count)
+		{
+			size_t capacity = GroupSize;
+			while (GetMaxLoad(capacity) < count)
+				capacity *= 2;
+			return capacity;
+		}
+
+		static inline uint32_t CountTrailingZeros(uint32_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, value);
+			return static_cast<uint32_t>(index);
+#else
+			return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+		}
+
+		Arena* m_Arena;
+		int8_t* m_Control = nullptr;
+		Slot* m_Slots = nullptr;
+		size_t m_Capacity = 0;
+		size_t m_Size = 0;
+		size_t m_Deleted = 0;
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Arrowhead/Arena.h"
+
+#include <cstdint>
+#include <string>
+
+namespace arwh
+{
+	// Read only copy of an arena's used range that is mapped straight from a file. Anything
+	// stored in the arena has to reference the rest of it through OffsetPtr since the
+	// mapping will almost never land at the address the arena was at
+	class ArenaSnapshot
+	{
+	public:
+		ArenaSnapshot() = default;
+		~ArenaSnapshot();
+
+		ArenaSnapshot(const ArenaSnapshot&) = delete;
+		ArenaSnapshot& operator=(const ArenaSnapshot&) = delete;
+
+		// Writes everything pushed onto the arena so far. The root is what GetRoot returns after
+		// loading and can be null, and the version is checked against the one passed to Load
+		static bool Save(const Arena* arena, const std::string& path, const void* root, uint32_t version = 0);
+
+		// Maps the file and checks its header, verifying the checksum reads the whole file in
+		bool Load(const std::string& path, uint32_t version = 0, bool verify = true);
+		void Unload();
+
+		template<typename T>
+		inline const T* GetRoot() const { return m_RootOffset != NullRoot ? reinterpret_cast<const T*>(m_Data + static_cast<size_t>(m_RootOffset)) : nullptr; }
+
+		inline const uint8_t* GetData() const { return m_Data; }
+		inline size_t GetSize() const { return m_Size; }
+		inline bool IsLoaded() const { return m_Mapping != nullptr; }
+
+		static constexpr uint32_t FormatVersion = 2;
+
+	private:
+		static constexpr uint64_t NullRoot = ~static_cast<uint64_t>(0);
+
+		struct Header
+		{
+			uint64_t Magic;
+			uint32_t FormatVersion;
+			uint32_t Version;
+			uint64_t Size;
+			uint64_t RootOffset;
+			uint64_t Checksum;
+			uint32_t DataPadding;
+			uint32_t Reserved[5];
+		};
+
+		static uint64_t Checksum(const Header& header, const uint8_t* data);
+		static uint64_t Checksum(const uint8_t* data, size_t size, uint64_t hash);
+
+		const void* m_Mapping = nullptr;
+		size_t m_MappingSize = 0;
+
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+		uint64_t m_RootOffset = NullRoot;
+	};
+}
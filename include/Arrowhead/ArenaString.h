@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Arrowhead/Arena.h"
+
+#include <cstdarg>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+
+namespace arwh
+{
+	// Immutable view of characters that live on an arena. Strings made by the functions
+	// here are always null terminated, but slices of them don't have to be
+	class ArenaString
+	{
+	public:
+		ArenaString()
+			: m_Data(""), m_Size(0) {}
+
+		ArenaString(const char* data, size_t size)
+			: m_Data(data), m_Size(size) {}
+
+		ArenaString(const char* data)
+			: m_Data(data), m_Size(strlen(data)) {}
+
+		static ArenaString Copy(Arena* arena, const char* data, size_t size);
+		static ArenaString Copy(Arena* arena, std::string_view string) { return Copy(arena, string.data(), string.size()); }
+
+		// printf style formatting straight into arena memory
+		static ArenaString Format(Arena* arena, const char* format, ...);
+		static ArenaString FormatList(Arena* arena, const char* format, va_list args);
+
+		inline ArenaString Slice(size_t offset, size_t size) const { return ArenaString(m_Data + offset, size); }
+		inline ArenaString Slice(size_t offset) const { return ArenaString(m_Data + offset, m_Size - offset); }
+
+		inline const char* Data() const { return m_Data; }
+		inline size_t GetSize() const { return m_Size; }
+		inline bool IsEmpty() const { return m_Size == 0; }
+
+		inline char operator[](size_t index) const { return m_Data[index]; }
+
+		inline std::string_view ToStringView() const { return std::string_view(m_Data, m_Size); }
+		inline operator std::string_view() const { return ToStringView(); }
+
+		inline const char* begin() const { return m_Data; }
+		inline const char* end() const { return m_Data + m_Size; }
+
+		bool operator==(const ArenaString& other) const { return ToStringView() == other.ToStringView(); }
+		bool operator!=(const ArenaString& other) const { return ToStringView() != other.ToStringView(); }
+
+	private:
+		const char* m_Data;
+		size_t m_Size;
+	};
+
+	inline std::ostream& operator<<(std::ostream& stream, const ArenaString& string)
+	{
+		return stream << string.ToStringView();
+	}
+
+	// Builds a string up on an arena. Appending grows the buffer in place while the builder
+	// owns the last block on the arena, so nothing else should be pushed until it's done
+	class ArenaStringBuilder
+	{
+	public:
+		ArenaStringBuilder(Arena* arena, size_t capacity = DefaultCapacity);
+
+		ArenaStringBuilder& Append(const char* data, size_t size);
+		ArenaStringBuilder& Append(std::string_view string) { return Append(string.data(), string.size()); }
+		ArenaStringBuilder& Append(char character) { return Append(&character, 1); }
+
+		ArenaStringBuilder& AppendFormat(const char* format, ...);
+		ArenaStringBuilder& AppendFormatList(const char* format, va_list args);
+
+		ArenaStringBuilder& operator<<(std::string_view string) { return Append(string); }
+		ArenaStringBuilder& operator<<(char character) { return Append(character); }
+
+		inline size_t GetSize() const { return m_Size; }
+
+		// Null terminates the buffer and returns a view of it, the builder can keep
+		// appending afterwards but that invalidates the returned string
+		ArenaString ToString();
+
+		static constexpr size_t DefaultCapacity = 64;
+
+	private:
+		void Reserve(size_t size);
+
+		Arena* m_Arena;
+		char* m_Data;
+		size_t m_Size;
+		size_t m_Capacity;
+	};
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Arrowhead/Arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace arwh
+{
+	// Growable array that lives on an arena. While it's the last thing on the arena it grows
+	// in place, otherwise it moves to a new block and leaves the old one for the arena to reclaim
+	template<typename T>
+	class ArenaVector
+	{
+	public:
+		ArenaVector(Arena* arena)
+			: m_Arena(arena), m_Data(nullptr), m_Size(0), m_Capacity(0) {}
+
+		ArenaVector(Arena* arena, size_t capacity)
+			: ArenaVector(arena)
+		{
+			Reserve(capacity);
+		}
+
+		ArenaVector(const ArenaVector&) = delete;
+		ArenaVector& operator=(const ArenaVector&) = delete;
+
+		ArenaVector(ArenaVector&& other) noexcept
+			: m_Arena(other.m_Arena), m_Data(other.m_Data), m_Size(other.m_Size), m_Capacity(other.m_Capacity)
+		{
+			other.m_Data = nullptr;
+			other.m_Size = 0;
+			other.m_Capacity = 0;
+		}
+
+		~ArenaVector()
+		{
+			Clear();
+		}
+
+		void PushBack(const T& value)
+		{
+			EmplaceBack(value);
+		}
+
+		void PushBack(T&& value)
+		{
+			EmplaceBack(std::move(value));
+		}
+
+		template<typename... Args>
+		T& EmplaceBack(Args&&... args)
+		{
+			if (m_Size == m_Capacity)
+				Grow(m_Size + 1);
+			return *new(m_Data + m_Size++) T(std::forward<Args>(args)...);
+		}
+
+		void PopBack()
+		{
+			m_Data[--m_Size].~T();
+		}
+
+		void Reserve(size_t capacity)
+		{
+			if (capacity > m_Capacity)
+				Grow(capacity);
+		}
+
+		void Resize(size_t size)
+		{
+			Reserve(size);
+			for (size_t i = m_Size; i < size; i++)
+				new(m_Data + i) T();
+			DestroyRange(size, m_Size);
+			m_Size = size;
+		}
+
+		void Clear()
+		{
+			DestroyRange(0, m_Size);
+			m_Size = 0;
+		}
+
+		inline T& operator[](size_t index) { return m_Data[index]; }
+		inline const T& operator[](size_t index) const { return m_Data[index]; }
+
+		inline T& Back() { return m_Data[m_Size - 1]; }
+		inline const T& Back() const { return m_Data[m_Size - 1]; }
+
+		inline T* Data() { return m_Data; }
+		inline const T* Data() const { return m_Data; }
+
+		inline size_t GetSize() const { return m_Size; }
+		inline size_t GetCapacity() const { return m_Capacity; }
+		inline bool IsEmpty() const { return m_Size == 0; }
+		inline Arena* GetArena() const { return m_Arena; }
+
+		inline T* begin() { return m_Data; }
+		inline T* end() { return m_Data + m_Size; }
+		inline const T* begin() const { return m_Data; }
+		inline const T* end() const { return m_Data + m_Size; }
+
+	private:
+		void Grow(size_t minCapacity)
+		{
+			size_t capacity = std::max<size_t>({ minCapacity, m_Capacity * 2, MinCapacity });
+
+			// Growing in place skips the copy entirely
+			if (m_Data != nullptr && m_Arena->Extend(m_Data, sizeof(T) * m_Capacity, sizeof(T) * capacity))
+			{
+				m_Capacity = capacity;
+				return;
+			}
+
+			T* data = m_Arena->PushArray<T>(capacity);
+			if constexpr (std::is_trivially_copyable<T>::value)
+			{
+				if (m_Size > 0)
+					memcpy(data, m_Data, sizeof(T) * m_Size);
+			}
+			else
+			{
+				for (size_t i = 0; i < m_Size; i++)
+				{
+					new(data + i) T(std::move(m_Data[i]));
+					m_Data[i].~T();
+				}
+			}
+
+			m_Data = data;
+			m_Capacity = capacity;
+		}
+
+		void DestroyRange(size_t begin, size_t end)
+		{
+			if constexpr (!std::is_trivially_destructible<T>::value)
+			{
+				for (size_t i = begin; i < end; i++)
+					m_Data[i].~T();
+			}
+		}
+
+		static constexpr size_t MinCapacity = 8;
+
+		Arena* m_Arena;
+		T* m_Data;
+		size_t m_Size;
+		size_t m_Capacity;
+	};
+}
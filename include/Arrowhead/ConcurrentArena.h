@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace arwh
+{
+	// Arena that any number of threads can push into at the same time without locking.
+	// Pushing is a single fetch-add on the current chunk, and when that runs out one of
+	// the threads links a new chunk on with a compare-exchange. Clearing and disposing
+	// are still single owner operations that can't overlap with any pushes
+	class ConcurrentArena
+	{
+	public:
+		ConcurrentArena(size_t chunkSize);
+		~ConcurrentArena();
+
+		ConcurrentArena(const ConcurrentArena&) = delete;
+		ConcurrentArena& operator=(const ConcurrentArena&) = delete;
+
+		// Every block is aligned to at least MinAlignment
+		void* Push(size_t size);
+		void* PushZero(size_t size);
+		void* PushAligned(size_t size, size_t alignment);
+
+		template<typename T>
+		T* PushArray(size_t count)
+		{
+			return reinterpret_cast<T*>(PushAligned(sizeof(T) * count, alignof(T)));
+		}
+
+		template<typename T>
+		T* PushStruct()
+		{
+			return reinterpret_cast<T*>(PushAligned(sizeof(T), alignof(T)));
+		}
+
+		void Clear();
+
+		static constexpr size_t MinAlignment = 16;
+		static constexpr uint32_t MaxGrowAttempts = 64;
+
+	private:
+		struct alignas(64) Chunk
+		{
+			std::atomic<size_t> Offset;
+			size_t Size;
+			Chunk* Prev;
+
+			inline uint8_t* GetData() { return reinterpret_cast<uint8_t*>(this + 1); }
+		};
+
+		void* PushSlow(Chunk* chunk, size_t size);
+		void* PushLarge(size_t size);
+
+		static Chunk* AllocateChunk(size_t size);
+		static void FreeChunks(Chunk* chunk);
+
+		std::atomic<Chunk*> m_Current;
+		std::atomic<Chunk*> m_LargeChunks;
+		size_t m_ChunkSize;
+	};
+}
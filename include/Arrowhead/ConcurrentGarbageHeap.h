@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Arrowhead/GarbageHeap.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace arwh
+{
+	// GarbageHeap that any number of threads can allocate on at once. Every thread gets its
+	// own heap the first time it allocates, so allocating never contends. CleanupGarbage
+	// still has to be called while nothing is allocating, and once there are enough objects
+	// to destroy it splits the destructor runs up across a pool of worker threads
+	class ConcurrentGarbageHeap
+	{
+	public:
+		ConcurrentGarbageHeap(size_t heapSize, uint32_t workerCount = DefaultWorkerCount(),
+			size_t parallelThreshold = DefaultParallelThreshold);
+		~ConcurrentGarbageHeap();
+
+		ConcurrentGarbageHeap(const ConcurrentGarbageHeap&) = delete;
+		ConcurrentGarbageHeap& operator=(const ConcurrentGarbageHeap&) = delete;
+
+		template<typename T, typename... Args>
+		inline T* Allocate(Args&&... args) { return GetThreadHeap()->Allocate<T>(std::forward<Args>(args)...); }
+
+		template<typename T, typename... Args>
+		inline T* AllocateArray(size_t count, const Args&... args) { return GetThreadHeap()->AllocateArray<T>(count, args...); }
+
+		GarbageHeap* GetThreadHeap();
+
+		void CleanupGarbage();
+
+		size_t GetUsedSize();
+		size_t GetCapacity();
+
+		static uint32_t DefaultWorkerCount();
+
+		static constexpr size_t DefaultParallelThreshold = 1 << 16;
+
+		// Most objects a single piece of parallel cleanup destroys
+		static constexpr size_t PieceSize = 1 << 14;
+
+	private:
+		void StartWorkers();
+		void WorkerLoop();
+		void DestroyPieces();
+
+	private:
+		size_t m_HeapSize;
+		size_t m_ParallelThreshold;
+		uint64_t m_Id;
+
+		std::mutex m_HeapMutex;
+		std::vector<std::pair<std::thread::id, std::unique_ptr<GarbageHeap>>> m_Heaps;
+
+		uint32_t m_WorkerCount;
+		std::vector<std::thread> m_Workers;
+		std::mutex m_WorkMutex;
+		std::condition_variable m_WorkReady;
+		std::condition_variable m_WorkDone;
+		std::vector<GarbageHeap::DestructorRecord> m_Pieces;
+		std::atomic<size_t> m_NextPiece = 0;
+		uint64_t m_Job = 0;
+		uint32_t m_BusyWorkers = 0;
+		bool m_Stopping = false;
+
+		static std::atomic<uint64_t> s_NextId;
+	};
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Arrowhead/ConcurrentArena.h"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace arwh
+{
+	// Version of PoolArenaAllocator that can be allocated from and freed to on any thread.
+	// The free list is a Treiber stack with a 16 bit tag packed into the unused top bits of
+	// the head pointer, so a node getting popped and pushed again between another thread
+	// reading the head and swapping it (the ABA problem) makes that swap fail
+	template<typename T>
+	class ConcurrentPoolAllocator
+	{
+	public:
+		struct Node
+		{
+			T Value;
+			std::atomic<Node*> Next;
+		};
+
+		static_assert(sizeof(void*) == 8, "ConcurrentPoolAllocator packs a tag into 64 bit pointers");
+
+		template<typename... Args>
+		T* Allocate(ConcurrentArena* arena, Args&&... args)
+		{
+			Node* node = PopFree();
+			if (node == nullptr)
+			{
+				// Nodes are never given back to the arena so a stale read of one is always safe
+				node = arena->PushStruct<Node>();
+				new(&node->Next) std::atomic<Node*>(nullptr);
+			}
+
+			return new(&node->Value) T(std::forward<Args>(args)...);
+		}
+
+		void Free(T* value)
+		{
+			value->~T();
+
+			// Cast the pointer up to a node and push it onto the free list
+			Node* node = reinterpret_cast<Node*>(value);
+			uint64_t head = m_Head.load(std::memory_order_relaxed);
+			uint64_t newHead;
+			do
+			{
+				node->Next.store(GetNode(head), std::memory_order_relaxed);
+				newHead = Pack(node, GetTag(head) + 1);
+			} while (!m_Head.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+	private:
+		Node* PopFree()
+		{
+			uint64_t head = m_Head.load(std::memory_order_acquire);
+			while (GetNode(head) != nullptr)
+			{
+				// The next pointer can be stale if another thread popped the node already, the tag
+				// will have changed in that case and the exchange fails
+				Node* next = GetNode(head)->Next.load(std::memory_order_relaxed);
+				if (m_Head.compare_exchange_weak(head, Pack(next, GetTag(head) + 1), std::memory_order_acquire, std::memory_order_acquire))
+					return GetNode(head);
+			}
+			return nullptr;
+		}
+
+		static constexpr uint64_t PointerBits = 48;
+		static constexpr uint64_t PointerMask = (uint64_t(1) << PointerBits) - 1;
+
+		static inline uint64_t Pack(Node* node, uint64_t tag) { return reinterpret_cast<uint64_t>(node) | (tag << PointerBits); }
+		static inline Node* GetNode(uint64_t head) { return reinterpret_cast<Node*>(head & PointerMask); }
+		static inline uint64_t GetTag(uint64_t head) { return head >> PointerBits; }
+
+		alignas(64) std::atomic<uint64_t> m_Head = 0;
+	};
+}
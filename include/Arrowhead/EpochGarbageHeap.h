@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Arrowhead/GarbageHeap.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace arwh
+{
+	// Ring of garbage heaps, one per epoch, for data that other threads keep reading after
+	// the frame that made it. The owning thread allocates into the heap of the current epoch
+	// and calls AdvanceEpoch at the end of each frame. Reader threads announce the epoch
+	// they're in with Enter/Leave, and may hold on to anything allocated within the last
+	// HeapCount - 1 epochs, counting the one they entered in. The epoch only moves on once
+	// every reader has caught up to it, which is what makes reusing the oldest heap safe
+	class EpochGarbageHeap
+	{
+	public:
+		EpochGarbageHeap(size_t heapSize, uint32_t heapCount = DefaultHeapCount);
+
+		EpochGarbageHeap(const EpochGarbageHeap&) = delete;
+		EpochGarbageHeap& operator=(const EpochGarbageHeap&) = delete;
+
+		// Allocation is only for the owning thread
+		template<typename T, typename... Args>
+		inline T* Allocate(Args&&... args) { return GetHeap()->Allocate<T>(std::forward<Args>(args)...); }
+
+		template<typename T, typename... Args>
+		inline T* AllocateArray(size_t count, const Args&... args) { return GetHeap()->AllocateArray<T>(count, args...); }
+
+		inline GarbageHeap* GetHeap() { return m_Heaps[m_Epoch.load(std::memory_order_relaxed) % m_Heaps.size()].get(); }
+
+		// Moves to the next epoch and cleans the heap it's about to reuse, but only if every
+		// reader has announced the current epoch. Returns false and changes nothing otherwise
+		bool TryAdvanceEpoch();
+
+		// Same as TryAdvanceEpoch but waits for slow readers to catch up
+		void AdvanceEpoch();
+
+		// Reader threads take a slot once and pass it to Enter/Leave after that
+		uint32_t RegisterThread();
+		void UnregisterThread(uint32_t slot);
+
+		// Can be nested on the same slot, only the outermost pair announces and leaves
+		void Enter(uint32_t slot);
+		void Leave(uint32_t slot);
+
+		inline uint64_t GetEpoch() const { return m_Epoch.load(std::memory_order_relaxed); }
+		inline uint32_t GetHeapCount() const { return static_cast<uint32_t>(m_Heaps.size()); }
+
+		static constexpr uint32_t DefaultHeapCount = 3;
+		static constexpr uint32_t MaxThreads = 64;
+
+	private:
+		static constexpr uint64_t Idle = 0;
+
+		struct alignas(64) ThreadSlot
+		{
+			std::atomic<uint64_t> Epoch = Idle;
+			std::atomic<bool> InUse = false;
+
+			// Only touched by the thread that registered the slot
+			uint32_t Depth = 0;
+		};
+
+		std::vector<std::unique_ptr<GarbageHeap>> m_Heaps;
+		alignas(64) std::atomic<uint64_t> m_Epoch = 1;
+		std::atomic<uint32_t> m_NumSlots = 0;
+		ThreadSlot m_Slots[MaxThreads];
+	};
+
+	// Keeps the thread in the current epoch for as long as it's alive
+	class EpochGuard
+	{
+	public:
+		EpochGuard(EpochGarbageHeap* heap, uint32_t slot)
+			: m_Heap(heap), m_Slot(slot)
+		{
+			m_Heap->Enter(m_Slot);
+		}
+
+		~EpochGuard()
+		{
+			m_Heap->Leave(m_Slot);
+		}
+
+		EpochGuard(const EpochGuard&) = delete;
+		EpochGuard& operator=(const EpochGuard&) = delete;
+
+	private:
+		EpochGarbageHeap* m_Heap;
+		uint32_t m_Slot;
+	};
+}
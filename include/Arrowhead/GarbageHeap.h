@@ -1,61 +1,110 @@
 #pragma once
 
 #include <iostream>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace arwh
 {
+	// Per frame object heap, everything allocated on it gets destroyed together by
+	// CleanupGarbage. Runs out of room by chaining another chunk on, and the chunks are
+	// kept around after cleanup so a bursty frame only pays for the mallocs once
 	class GarbageHeap
 	{
 	public:
 		GarbageHeap(size_t size);
 		~GarbageHeap();
 
-		struct BaseGarbagePointer
+		GarbageHeap(const GarbageHeap&) = delete;
+		GarbageHeap& operator=(const GarbageHeap&) = delete;
+
+		// One record covers a run of objects of the same type sitting next to each other in
+		// the buffer, so cleanup is a single call per run instead of one per object
+		struct DestructorRecord
 		{
-			virtual ~BaseGarbagePointer() {}
+			void (*Destroy)(void* objects, size_t count);
+			void* Objects;
+			size_t Count;
+			size_t ObjectSize;
 		};
 
-		template<typename T>
-		struct GarbagePointer : public BaseGarbagePointer
+		template<typename T, typename... Args>
+		T* Allocate(Args&&... args)
 		{
-			T* Pointer;
+			T* object = new(Push(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+			// Nothing needs to happen at cleanup for trivial types so they don't get a record
+			if constexpr (!std::is_trivially_destructible<T>::value)
+				AddDestructor(&DestroyRange<T>, object, 1, sizeof(T));
+
+			return object;
+		}
 
-			GarbagePointer(T* pointer)
-				: Pointer(pointer) {}
+		// Every element gets constructed from the same arguments
+		template<typename T, typename... Args>
+		T* AllocateArray(size_t count, const Args&... args)
+		{
+			T* objects = reinterpret_cast<T*>(Push(sizeof(T) * count, alignof(T)));
+			for (size_t i = 0; i < count; i++)
+				new(objects + i) T(args...);
 
-			virtual ~GarbagePointer() override
+			if constexpr (!std::is_trivially_destructible<T>::value)
 			{
-				Pointer->~T();
+				if (count > 0)
+					AddDestructor(&DestroyRange<T>, objects, count, sizeof(T));
 			}
-		};
 
-		template<typename T>
-		T* Allocate()
-		{
-			// Get pointer of offset into m_Pointers array
-			BaseGarbagePointer* pointer = 
-				reinterpret_cast<BaseGarbagePointer*>(reinterpret_cast<GarbagePointer<void>*>(m_Pointers) + m_NumPointers);
+			return objects;
+		}
 
-			// Get pointer of the aligned memory block getting allocated
-			T* memBlock = reinterpret_cast<T*>(((reinterpret_cast<uint64_t>(m_BufferCursor) + alignof(T) - 1) / alignof(T)) * alignof(T));
+		void CleanupGarbage();
 
-			// Create a new garbage collection helper
-			new(pointer) GarbagePointer<T>(memBlock);
+		// Bytes handed out since the last cleanup, alignment padding included
+		size_t GetUsedSize() const;
+		inline size_t GetCapacity() const { return m_Capacity; }
+		inline uint32_t GetNumChunks() const { return m_NumChunks; }
+		inline uint32_t GetNumRecords() const { return m_NumRecords; }
 
-			// Move buffer cursor to past the allocated block
-			m_BufferCursor = reinterpret_cast<void*>(reinterpret_cast<uint64_t>(memBlock) + sizeof(T));
+	private:
+		struct Chunk
+		{
+			Chunk* Next;
+			size_t Size;
+
+			inline char* GetData() { return reinterpret_cast<char*>(this + 1); }
+		};
 
-			m_NumPointers++;
-			return memBlock;
+		template<typename T>
+		static void DestroyRange(void* objects, size_t count)
+		{
+			T* typed = static_cast<T*>(objects);
+			for (size_t i = 0; i < count; i++)
+				typed[i].~T();
 		}
 
-		void CleanupGarbage();
+		void* Push(size_t size, size_t alignment);
+		void SortRecords();
+		void ResetBuffer();
+		void NextChunk(size_t minSize);
+		void AddDestructor(void (*destroy)(void*, size_t), void* objects, size_t count, size_t objectSize);
+
+		static Chunk* AllocateChunk(size_t size);
 
 	private:
-		void* m_Buffer;
-		void* m_BufferCursor;
+		friend class ConcurrentGarbageHeap;
+
+		Chunk* m_FirstChunk;
+		Chunk* m_Chunk;
+		char* m_BufferCursor;
+		char* m_BufferEnd;
+		size_t m_ChunkSize;
+		size_t m_Capacity;
+		size_t m_UsedInPrevChunks = 0;
+		uint32_t m_NumChunks = 1;
 
-		void* m_Pointers;
-		uint32_t m_NumPointers;
+		DestructorRecord* m_Records;
+		uint32_t m_NumRecords = 0;
+		uint32_t m_RecordCapacity;
 	};
 }
\ No newline at end of file
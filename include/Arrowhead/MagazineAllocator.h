@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Arrowhead/ConcurrentArena.h"
+
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace arwh
+{
+	// Thread caching pool allocation in the style of Bonwick's magazines. Each thread keeps a
+	// MagazineCache with two magazines (stacks of free objects) that it allocates from and
+	// frees to without touching any shared memory. Only when both are empty or both are full
+	// does it swap a whole magazine with the shared MagazineDepot, so the cost of the depot
+	// lock is spread over MagazineSize allocations
+	template<typename T, uint32_t MagazineSize = 64>
+	class MagazineDepot
+	{
+	public:
+		struct Magazine
+		{
+			Magazine* Next;
+			uint32_t Count;
+			T* Objects[MagazineSize];
+		};
+
+		MagazineDepot(ConcurrentArena* arena)
+			: m_Arena(arena) {}
+
+		MagazineDepot(const MagazineDepot&) = delete;
+		MagazineDepot& operator=(const MagazineDepot&) = delete;
+
+		// Returns a magazine with at least one object in it, filling a new one from the
+		// arena with a single push if the depot doesn't have any
+		Magazine* TakeFull()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (m_Full != nullptr)
+					return Pop(m_Full);
+			}
+
+			struct alignas(T) Storage { unsigned char Bytes[sizeof(T)]; };
+			Storage* objects = m_Arena->PushArray<Storage>(MagazineSize);
+
+			Magazine* magazine = TakeEmpty();
+			for (uint32_t i = 0; i < MagazineSize; i++)
+				magazine->Objects[i] = reinterpret_cast<T*>(objects + i);
+			magazine->Count = MagazineSize;
+			return magazine;
+		}
+
+		Magazine* TakeEmpty()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (m_Empty != nullptr)
+					return Pop(m_Empty);
+			}
+
+			Magazine* magazine = m_Arena->PushStruct<Magazine>();
+			magazine->Next = nullptr;
+			magazine->Count = 0;
+			return magazine;
+		}
+
+		// Takes back a magazine of any fill level
+		void Return(Magazine* magazine)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			Magazine*& list = magazine->Count > 0 ? m_Full : m_Empty;
+			magazine->Next = list;
+			list = magazine;
+		}
+
+	private:
+		static inline Magazine* Pop(Magazine*& list)
+		{
+			Magazine* magazine = list;
+			list = magazine->Next;
+			return magazine;
+		}
+
+		ConcurrentArena* m_Arena;
+
+		std::mutex m_Mutex;
+		Magazine* m_Full = nullptr;
+		Magazine* m_Empty = nullptr;
+	};
+
+	// Per thread front end for a MagazineDepot, usually declared thread_local. Objects can be
+	// freed to any thread's cache, not just the one that allocated them
+	template<typename T, uint32_t MagazineSize = 64>
+	class MagazineCache
+	{
+	public:
+		using Depot = MagazineDepot<T, MagazineSize>;
+		using Magazine = typename Depot::Magazine;
+
+		MagazineCache(Depot& depot)
+			: m_Depot(depot), m_Loaded(depot.TakeEmpty()), m_Previous(depot.TakeEmpty()) {}
+
+		~MagazineCache()
+		{
+			m_Depot.Return(m_Loaded);
+			m_Depot.Return(m_Previous);
+		}
+
+		MagazineCache(const MagazineCache&) = delete;
+		MagazineCache& operator=(const MagazineCache&) = delete;
+
+		template<typename... Args>
+		T* Allocate(Args&&... args)
+		{
+			if (m_Loaded->Count == 0)
+			{
+				// Swap to the previous magazine if it has anything left, otherwise trade the
+				// empty one in for a full one from the depot
+				if (m_Previous->Count == 0)
+				{
+					m_Depot.Return(m_Previous);
+					m_Previous = m_Depot.TakeFull();
+				}
+				std::swap(m_Loaded, m_Previous);
+			}
+
+			T* value = m_Loaded->Objects[--m_Loaded->Count];
+			return new(value) T(std::forward<Args>(args)...);
+		}
+
+		void Free(T* value)
+		{
+			value->~T();
+
+			if (m_Loaded->Count == MagazineSize)
+			{
+				// Same idea in reverse, trade a full magazine in for an empty one
+				if (m_Previous->Count == MagazineSize)
+				{
+					m_Depot.Return(m_Previous);
+					m_Previous = m_Depot.TakeEmpty();
+				}
+				std::swap(m_Loaded, m_Previous);
+			}
+
+			m_Loaded->Objects[m_Loaded->Count++] = value;
+		}
+
+	private:
+		Depot& m_Depot;
+		Magazine* m_Loaded;
+		Magazine* m_Previous;
+	};
+}
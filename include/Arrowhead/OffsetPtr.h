@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace arwh
+{
+	// Pointer stored as the distance from itself to what it points at, so a structure that
+	// only uses these keeps working after its memory is copied or mapped somewhere else.
+	// An offset of zero is null, which means it can't point at itself
+	template<typename T>
+	class OffsetPtr
+	{
+	public:
+		OffsetPtr()
+			: m_Offset(0) {}
+
+		OffsetPtr(std::nullptr_t)
+			: m_Offset(0) {}
+
+		OffsetPtr(T* pointer)
+		{
+			Set(pointer);
+		}
+
+		// Copies have to be worked out again relative to their own address
+		OffsetPtr(const OffsetPtr& other)
+		{
+			Set(other.Get());
+		}
+
+		OffsetPtr& operator=(const OffsetPtr& other)
+		{
+			Set(other.Get());
+			return *this;
+		}
+
+		OffsetPtr& operator=(T* pointer)
+		{
+			Set(pointer);
+			return *this;
+		}
+
+		OffsetPtr& operator=(std::nullptr_t)
+		{
+			m_Offset = 0;
+			return *this;
+		}
+
+		inline T* Get() const
+		{
+			if (m_Offset == 0)
+				return nullptr;
+			return reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + m_Offset);
+		}
+
+		inline T* operator->() const { return Get(); }
+		inline T& operator*() const { return *Get(); }
+		inline T& operator[](size_t index) const { return Get()[index]; }
+
+		inline explicit operator bool() const { return m_Offset != 0; }
+
+		bool operator==(const OffsetPtr& other) const { return Get() == other.Get(); }
+		bool operator!=(const OffsetPtr& other) const { return Get() != other.Get(); }
+
+	private:
+		inline void Set(T* pointer)
+		{
+			m_Offset = pointer == nullptr ? 0 : reinterpret_cast<intptr_t>(pointer) - reinterpret_cast<intptr_t>(this);
+		}
+
+		int64_t m_Offset;
+	};
+}
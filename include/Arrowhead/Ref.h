@@ -1,27 +1,327 @@
 #pragma once
 
+#include "Arrowhead/RefReleaseQueue.h"
+
 #include <atomic>
+#include <cstdint>
+#include <new>
 #include <type_traits>
 
 namespace arwh
 {
-	class RefCount
+	// How an object keeps its reference count, picked with the template argument of BasicRefCount
+	struct AtomicRefPolicy {};	// Safe to share between any threads
+	struct LocalRefPolicy {};	// Never leaves the thread, so the count doesn't need to be atomic
+	struct BiasedRefPolicy {};	// Mostly used on the thread that made it, but can be shared
+
+	// Gives the block an object was made in back to where it came from, the object has already
+	// been destroyed by then. Allocators that hand these out have to outlive everything they
+	// made, WeakRefs to it included
+	struct RefDeleter
+	{
+		void (*Free)(RefDeleter* deleter, void* block);
+
+		constexpr RefDeleter(void (*free)(RefDeleter*, void*))
+			: Free(free) {}
+	};
+
+	template<typename T>
+	class Ref;
+
+	template<typename T>
+	class WeakRef;
+
+	// Start of every RefControl
+	struct RefControlBase
+	{
+		// Where the block the control shares with its object goes back to
+		RefDeleter* Deleter = nullptr;
+	};
+
+	// Counts of an atomic or local object. They sit in front of the object in the same block
+	// but outlive it, so a WeakRef can still use them after the object is destroyed
+	template<typename Policy>
+	struct RefControl;
+
+	template<>
+	struct RefControl<AtomicRefPolicy> : RefControlBase
+	{
+		// Taking another reference needs no ordering since whoever copies already has one
+		void IncRefCount()
+		{
+			RefCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Returns true when that was the last reference. Release so our writes to the object
+		// happen before the delete, acquire so the deleting thread sees everyone else's
+		bool DecRefCount()
+		{
+			return RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+		}
+
+		// Only succeeds while the object is still alive, for turning a WeakRef into a Ref
+		bool TryIncRefCount()
+		{
+			uint32_t count = RefCount.load(std::memory_order_relaxed);
+			while (count != 0)
+			{
+				if (RefCount.compare_exchange_weak(count, count + 1, std::memory_order_relaxed))
+					return true;
+			}
+			return false;
+		}
+
+		void IncWeakCount()
+		{
+			WeakCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Returns true when the block the control shares with the object can be freed
+		bool DecWeakCount()
+		{
+			return WeakCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+		}
+
+		bool HasWeakRefs() const { return WeakCount.load(std::memory_order_acquire) != 1; }
+
+		uint32_t GetRefCount() const { return RefCount.load(std::memory_order_relaxed); }
+
+		std::atomic<uint32_t> RefCount = 0;
+
+		// Every weak reference plus one for all the strong ones together
+		std::atomic<uint32_t> WeakCount = 1;
+	};
+
+	template<>
+	struct RefControl<LocalRefPolicy> : RefControlBase
+	{
+		void IncRefCount()
+		{
+			++RefCount;
+		}
+
+		bool DecRefCount()
+		{
+			return --RefCount == 0;
+		}
+
+		bool TryIncRefCount()
+		{
+			if (RefCount == 0)
+				return false;
+			++RefCount;
+			return true;
+		}
+
+		void IncWeakCount()
+		{
+			++WeakCount;
+		}
+
+		bool DecWeakCount()
+		{
+			return --WeakCount == 0;
+		}
+
+		bool HasWeakRefs() const { return WeakCount != 1; }
+
+		uint32_t GetRefCount() const { return RefCount; }
+
+		uint32_t RefCount = 0;
+		uint32_t WeakCount = 1;
+	};
+
+	// The blocks atomic and local objects share with their RefControl, the control goes at
+	// the start and the object after it. The object's constructor picks its control up from a
+	// per-thread stack of blocks whose objects are still being constructed
+	class RefBlock
 	{
 	public:
+		template<typename Control>
+		static constexpr size_t GetObjectOffset(size_t alignment) { return (sizeof(Control) + alignment - 1) & ~(alignment - 1); }
+
+		// Puts a control at the start of block and returns where the object goes
+		template<typename Control>
+		static void* Prepare(void* block, RefDeleter* deleter, size_t size, size_t alignment)
+		{
+			Control* control = new(block) Control();
+			control->Deleter = deleter;
+
+			void* object = static_cast<uint8_t*>(block) + GetObjectOffset<Control>(alignment);
+			PushPending(control, object, size);
+			return object;
+		}
+
+		// For objects made with new
+		template<typename Control>
+		static void* New(size_t size, size_t alignment)
+		{
+			void* block = ::operator new(GetObjectOffset<Control>(alignment) + size, std::align_val_t(alignment));
+			return Prepare<Control>(block, GetHeapDeleter(alignment), size, alignment);
+		}
+
+		template<typename Control>
+		static void Delete(void* object, size_t alignment)
+		{
+			RefControlBase* control = reinterpret_cast<RefControlBase*>(static_cast<uint8_t*>(object) - GetObjectOffset<Control>(alignment));
+			CancelPending(control);
+			Free(control);
+		}
+
+		static void Free(RefControlBase* control) { control->Deleter->Free(control->Deleter, control); }
+
+		// The control of the block the object being constructed is in, null when it didn't come from one
+		static RefControlBase* TakePending(const void* subobject);
+
+	private:
+		// Blocks from New keep the alignment they were allocated with in which of these they point at
+		static RefDeleter* GetHeapDeleter(size_t alignment);
+
+		static void PushPending(RefControlBase* control, const void* object, size_t size);
+
+		// Only does anything when the constructor threw before picking the control up
+		static void CancelPending(RefControlBase* control);
+	};
+
+	// Atomic and local objects only point at their counts, see RefControl and RefBlock
+	template<typename Policy>
+	class BasicRefCount
+	{
+	public:
+		using RefPolicy = Policy;
+
+		// Objects that didn't come from new or Ref::Create have no counts, they can't be
+		// put in a Ref or counted
+		BasicRefCount()
+			: m_Control(static_cast<RefControl<Policy>*>(RefBlock::TakePending(this))) {}
+
+		BasicRefCount(const BasicRefCount&) = delete;
+		BasicRefCount& operator=(const BasicRefCount&) = delete;
+
+		void IncRefCount() const { m_Control->IncRefCount(); }
+
+		// Returns true when that was the last reference
+		bool DecRefCount() const { return m_Control->DecRefCount(); }
+
+		uint32_t GetRefCount() const { return m_Control ? m_Control->GetRefCount() : 0; }
+
+		// New puts the counts in front of the object in the same block. Deleting an object
+		// directly is only fine while no WeakRef is watching it
+		static void* operator new(size_t size) { return RefBlock::New<RefControl<Policy>>(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+		static void* operator new(size_t size, std::align_val_t alignment) { return RefBlock::New<RefControl<Policy>>(size, static_cast<size_t>(alignment)); }
+		static void operator delete(void* object) { RefBlock::Delete<RefControl<Policy>>(object, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+		static void operator delete(void* object, std::align_val_t alignment) { RefBlock::Delete<RefControl<Policy>>(object, static_cast<size_t>(alignment)); }
+
+		// Declaring the ones above hides the global placement new
+		static void* operator new(size_t, void* where) noexcept { return where; }
+		static void operator delete(void*, void*) noexcept {}
+
+	private:
+		mutable RefControl<Policy>* m_Control;
+
+		template<typename T>
+		friend class Ref;
+
+		template<typename T>
+		friend class WeakRef;
+	};
+
+	class BiasedRefQueue;
+
+	// Biased reference counting: the first thread to take a reference to the object becomes
+	// its owner and keeps a plain count, every other thread goes through an atomic shared count. When the owner's count drops
+	// to zero the two are merged and the object turns into a normal atomic one. If the
+	// shared count goes negative before that, the object is queued up for its owner to merge,
+	// which happens when the owner calls ProcessQueue or exits. Objects that end up released
+	// by the queue are deleted through the base class, hence the virtual destructor
+	template<>
+	class BasicRefCount<BiasedRefPolicy>
+	{
+	public:
+		using RefPolicy = BiasedRefPolicy;
+
+		BasicRefCount() = default;
+		virtual ~BasicRefCount();
+
+		BasicRefCount(const BasicRefCount&) = delete;
+		BasicRefCount& operator=(const BasicRefCount&) = delete;
+
 		void IncRefCount() const
 		{
-			++m_RefCount;
+			if (IsOwner() || TryClaim())
+				m_BiasedCount++;
+			else
+				m_SharedCount.fetch_add(SharedOne, std::memory_order_relaxed);
 		}
-		void DecRefCount() const
+
+		bool DecRefCount() const
 		{
-			--m_RefCount;
+			if (IsOwner())
+				return --m_BiasedCount == 0 && Merge(0);
+			return DecSharedCount();
 		}
 
-		uint32_t GetRefCount() const { return m_RefCount.load(); }
+		// Only exact on the owning thread or once the counts have been merged
+		uint32_t GetRefCount() const;
+
+		// Merges everything other threads queued up for this thread, call it at a safe point
+		static void ProcessQueue();
+
 	private:
-		mutable std::atomic<uint32_t> m_RefCount = 0;
+		friend class BiasedRefQueue;
+
+		// The shared count lives in the upper bits, with these flags in the bottom two
+		static constexpr int64_t Merged = 1;
+		static constexpr int64_t Queued = 2;
+		static constexpr int64_t SharedOne = 4;
+
+		static inline int64_t GetCount(int64_t shared) { return (shared & ~(Merged | Queued)) / SharedOne; }
+
+		inline bool IsOwner() const
+		{
+			BiasedRefQueue* owner = m_Owner.load(std::memory_order_relaxed);
+			return owner != nullptr && owner == s_ThreadQueue;
+		}
+
+		// Objects that nobody has taken a reference to yet don't have an owner. Merged ones
+		// don't either, but those have the flag set and never get one again
+		inline bool TryClaim() const
+		{
+			return m_Owner.load(std::memory_order_relaxed) == nullptr && (m_SharedCount.load(std::memory_order_relaxed) & Merged) == 0 && Claim();
+		}
+
+		bool Claim() const;
+		bool DecSharedCount() const;
+		bool Merge(int64_t clearFlags) const;
+
+		// For objects released by the queue, where only the base class is known
+		static void Destroy(const BasicRefCount* object);
+
+		mutable std::atomic<BiasedRefQueue*> m_Owner = nullptr;
+		mutable uint32_t m_BiasedCount = 0;
+		mutable std::atomic<int64_t> m_SharedCount = 0;
+
+		static thread_local BiasedRefQueue* s_ThreadQueue;
+		// Null for objects that came from new
+		RefDeleter* m_Deleter = nullptr;
+
+		template<typename T>
+		friend class Ref;
 	};
 
+	using RefCount = BasicRefCount<AtomicRefPolicy>;
+	using LocalRefCount = BasicRefCount<LocalRefPolicy>;
+	using BiasedRefCount = BasicRefCount<BiasedRefPolicy>;
+
+	template<typename T, typename = void>
+	struct IsRefCounted : std::false_type {};
+
+	template<typename T>
+	struct IsRefCounted<T, std::void_t<typename T::RefPolicy>> : std::is_base_of<BasicRefCount<typename T::RefPolicy>, T> {};
+
+	template<typename T>
+	class WeakRef;
+
 	template<typename T>
 	class Ref
 	{
@@ -29,25 +329,41 @@ namespace arwh
 		Ref()
 			: m_Value(nullptr)
 		{
-			static_assert(std::is_base_of<RefCount, T>::value, "Ref class can only be used with types that inherit from RefCount!");
+			static_assert(IsRefCounted<T>::value, "Ref class can only be used with types that inherit from RefCount!");
 		}
 
 		Ref(std::nullptr_t)
 			: m_Value(nullptr) {}
 
 		template<typename J>
-		Ref(Ref<J>& value)
-			: m_Value(dynamic_cast<T*>(value.Raw()))
+		Ref(const Ref<J>& other)
+			: m_Value(dynamic_cast<T*>(other.m_Value))
 		{
 			IncRef();
 		}
 
+		template<typename J>
+		Ref(Ref<J>&& other) noexcept
+			: m_Value(dynamic_cast<T*>(other.m_Value))
+		{
+			// A failed cast leaves the reference with other
+			if (m_Value)
+				other.m_Value = nullptr;
+		}
+
 		Ref(const Ref<T>& other)
 			: m_Value(other.m_Value)
 		{
 			IncRef();
 		}
 
+		// Moving hands the reference over without touching the count
+		Ref(Ref<T>&& other) noexcept
+			: m_Value(other.m_Value)
+		{
+			other.m_Value = nullptr;
+		}
+
 		Ref(T* value)
 			: m_Value(value)
 		{
@@ -66,10 +382,34 @@ namespace arwh
 			return *this;
 		}
 
+		Ref& operator=(const Ref<T>& other)
+		{
+			// Take the new reference first in case both point at the same object
+			if (other.m_Value)
+				other.m_Value->IncRefCount();
+			DecRef();
+
+			m_Value = other.m_Value;
+			return *this;
+		}
+
+		Ref& operator=(Ref<T>&& other) noexcept
+		{
+			if (this != &other)
+			{
+				DecRef();
+
+				m_Value = other.m_Value;
+				other.m_Value = nullptr;
+			}
+			return *this;
+		}
+
 		template<typename J>
 		Ref& operator=(const Ref<J>& other)
 		{
-			other.IncRef();
+			if (other.m_Value)
+				other.m_Value->IncRefCount();
 			DecRef();
 
 			m_Value = other.m_Value;
@@ -107,9 +447,57 @@ namespace arwh
 		template<typename... Args>
 		static Ref<T> Create(Args&&... args) { return Ref<T>(new T(std::forward<Args>(args)...)); }
 
+		// Makes the object in a block from one of the allocators in RefAllocator.h, which hand
+		// out GetStorageSize bytes at a time. The last release gives the block back to that
+		// allocator instead of calling delete
+		template<typename Allocator, typename... Args, typename = std::enable_if_t<std::is_base_of<RefDeleter, Allocator>::value>>
+		static Ref<T> Create(Allocator& allocator, Args&&... args)
+		{
+			static_assert(std::is_same<typename Allocator::ValueType, T>::value, "Allocator has to make objects of the same type as the Ref!");
+
+			if constexpr (IsBiased())
+			{
+				T* value = new(allocator.Allocate()) T(std::forward<Args>(args)...);
+				value->m_Deleter = &allocator;
+				return Ref<T>(value);
+			}
+			else
+			{
+				void* object = RefBlock::Prepare<RefControl<typename T::RefPolicy>>(allocator.Allocate(), &allocator, sizeof(T), alignof(T));
+				return Ref<T>(new(object) T(std::forward<Args>(args)...));
+			}
+		}
+
+		// Size and alignment of the block Create makes an object in, functions so Ref still
+		// works as a member of an incomplete T
+		static constexpr size_t GetStorageSize() { return GetObjectOffset() + sizeof(T); }
+		static constexpr size_t GetStorageAlignment() { return alignof(T) > alignof(RefControlBase) ? alignof(T) : alignof(RefControlBase); }
+
 	private:
+		template<typename J>
+		friend class Ref;
+
+		friend class WeakRef<T>;
+
+		// Takes over a reference that has already been counted
+		struct AdoptTag {};
+
+		Ref(T* value, AdoptTag)
+			: m_Value(value) {}
+
 		T* m_Value;
 
+		// Biased objects keep everything inside of them
+		static constexpr bool IsBiased() { return std::is_same<typename T::RefPolicy, BiasedRefPolicy>::value; }
+
+		static constexpr size_t GetObjectOffset()
+		{
+			if constexpr (IsBiased())
+				return 0;
+			else
+				return RefBlock::GetObjectOffset<RefControl<typename T::RefPolicy>>(alignof(T));
+		}
+
 		void IncRef()
 		{
 			if (m_Value)
@@ -120,13 +508,167 @@ namespace arwh
 		{
 			if (m_Value)
 			{
-				m_Value->DecRefCount();
-				if (m_Value->GetRefCount() == 0)
+				if (m_Value->DecRefCount())
 				{
-					delete m_Value;
+					if (!RefReleaseQueue::IsDeferred() || !RefReleaseQueue::Defer(&ReleaseDeferred, m_Value))
+						Release(m_Value);
 					m_Value = nullptr;
 				}
 			}
 		}
+
+		static void Release(T* value)
+		{
+			if constexpr (IsBiased())
+			{
+				RefDeleter* deleter = value->m_Deleter;
+				if (!deleter)
+				{
+					delete value;
+					return;
+				}
+
+				// Start of the block the allocator gave out, which isn't value itself when it points at a base class
+				void* base = dynamic_cast<void*>(value);
+				value->~T();
+				deleter->Free(deleter, base);
+			}
+			else
+			{
+				// Only the object goes away here, the counts stay until the last WeakRef is done with them
+				RefControl<typename T::RefPolicy>* control = value->m_Control;
+				value->~T();
+
+				// Nothing can start watching the object without a reference to it, so the block
+				// can be freed right away if no WeakRef has it
+				if (!control->HasWeakRefs() || control->DecWeakCount())
+					RefBlock::Free(control);
+			}
+		}
+
+		static void ReleaseDeferred(void* object)
+		{
+			Release(static_cast<T*>(object));
+		}
+
+		static void ReleaseWeak(RefControl<typename T::RefPolicy>* control)
+		{
+			if (control->DecWeakCount())
+				RefBlock::Free(control);
+		}
+	};
+
+	// Watches an object without keeping it alive. Once the last Ref is gone the object is
+	// destroyed right away, but its RefControl stays around until the last WeakRef lets go
+	// of it, along with the object's memory when Create put both in one block
+	template<typename T>
+	class WeakRef
+	{
+	public:
+		WeakRef()
+			: m_Value(nullptr), m_Control(nullptr)
+		{
+			static_assert(!std::is_same<typename T::RefPolicy, BiasedRefPolicy>::value, "WeakRef doesn't support biased reference counts!");
+		}
+
+		WeakRef(std::nullptr_t)
+			: WeakRef() {}
+
+		WeakRef(const Ref<T>& ref)
+			: m_Value(ref.m_Value), m_Control(m_Value ? m_Value->m_Control : nullptr)
+		{
+			IncWeak();
+		}
+
+		WeakRef(const WeakRef<T>& other)
+			: m_Value(other.m_Value), m_Control(other.m_Control)
+		{
+			IncWeak();
+		}
+
+		WeakRef(WeakRef<T>&& other) noexcept
+			: m_Value(other.m_Value), m_Control(other.m_Control)
+		{
+			other.m_Value = nullptr;
+			other.m_Control = nullptr;
+		}
+
+		~WeakRef()
+		{
+			DecWeak();
+		}
+
+		WeakRef& operator=(const WeakRef<T>& other)
+		{
+			if (other.m_Control)
+				other.GetControl()->IncWeakCount();
+			DecWeak();
+
+			m_Value = other.m_Value;
+			m_Control = other.m_Control;
+			return *this;
+		}
+
+		WeakRef& operator=(WeakRef<T>&& other) noexcept
+		{
+			if (this != &other)
+			{
+				DecWeak();
+
+				m_Value = other.m_Value;
+				m_Control = other.m_Control;
+				other.m_Value = nullptr;
+				other.m_Control = nullptr;
+			}
+			return *this;
+		}
+
+		WeakRef& operator=(const Ref<T>& ref)
+		{
+			return *this = WeakRef<T>(ref);
+		}
+
+		WeakRef& operator=(std::nullptr_t)
+		{
+			Reset();
+			return *this;
+		}
+
+		// Null if the object is already gone
+		Ref<T> Lock() const
+		{
+			if (m_Control && GetControl()->TryIncRefCount())
+				return Ref<T>(m_Value, typename Ref<T>::AdoptTag());
+			return nullptr;
+		}
+
+		bool IsExpired() const { return !m_Control || GetControl()->GetRefCount() == 0; }
+
+		void Reset()
+		{
+			DecWeak();
+			m_Value = nullptr;
+			m_Control = nullptr;
+		}
+
+	private:
+		T* m_Value;
+
+		// Left untyped so a WeakRef can be a member of T itself
+		void* m_Control;
+
+		inline RefControl<typename T::RefPolicy>* GetControl() const { return static_cast<RefControl<typename T::RefPolicy>*>(m_Control); }
+
+		void IncWeak()
+		{
+			if (m_Control)
+				GetControl()->IncWeakCount();
+		}
+
+		void DecWeak()
+		{
+			if (m_Control)
+				Ref<T>::ReleaseWeak(GetControl());
+		}
 	};
-}
\ No newline at end of file
+}
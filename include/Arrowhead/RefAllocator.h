@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Arrowhead/Arena.h"
+#include "Arrowhead/Ref.h"
+#include "Arrowhead/SizeClassAllocator.h"
+
+#include <cstdint>
+
+namespace arwh
+{
+	// Allocators to pass to Ref<T>::Create so refcounted objects come from and go back to a
+	// pool instead of the global heap. They only hand out raw blocks of Ref<T>::GetStorageSize
+	// bytes, how the object is laid out in them is up to Create. Every object only stores a
+	// pointer to the allocator it came from, so the allocator has to stay put and outlive them.
+	// Neither of these is thread safe, the block has to be freed on the thread using the allocator
+
+	// Recycles objects of one type through a PoolArenaAllocator
+	template<typename T>
+	class RefPoolAllocator : public RefDeleter
+	{
+	public:
+		using ValueType = T;
+
+		RefPoolAllocator(Arena* arena)
+			: RefDeleter(&FreeObject), m_Arena(arena) {}
+
+		RefPoolAllocator(const RefPoolAllocator&) = delete;
+		RefPoolAllocator& operator=(const RefPoolAllocator&) = delete;
+
+		void* Allocate()
+		{
+			return m_Pool.Allocate(m_Arena);
+		}
+
+		inline Arena* GetArena() const { return m_Arena; }
+
+	private:
+		// Raw block for the pool, the empty constructor keeps it from being zeroed
+		struct Storage
+		{
+			Storage() {}
+
+			alignas(Ref<T>::GetStorageAlignment()) uint8_t Data[Ref<T>::GetStorageSize()];
+		};
+
+		static void FreeObject(RefDeleter* deleter, void* block)
+		{
+			static_cast<RefPoolAllocator*>(deleter)->m_Pool.FreeDestroyed(static_cast<Storage*>(block));
+		}
+
+		Arena* m_Arena;
+		PoolArenaAllocator<Storage> m_Pool;
+	};
+
+	// Puts objects of one type into the matching size class of a shared SizeClassAllocator
+	template<typename T>
+	class RefSizeClassAllocator : public RefDeleter
+	{
+	public:
+		using ValueType = T;
+
+		RefSizeClassAllocator(SizeClassAllocator* allocator)
+			: RefDeleter(&FreeObject), m_Allocator(allocator) {}
+
+		RefSizeClassAllocator(const RefSizeClassAllocator&) = delete;
+		RefSizeClassAllocator& operator=(const RefSizeClassAllocator&) = delete;
+
+		void* Allocate()
+		{
+			return m_Allocator->Allocate(Ref<T>::GetStorageSize(), Ref<T>::GetStorageAlignment());
+		}
+
+		inline SizeClassAllocator* GetAllocator() const { return m_Allocator; }
+
+	private:
+		static void FreeObject(RefDeleter* deleter, void* block)
+		{
+			static_cast<RefSizeClassAllocator*>(deleter)->m_Allocator->Free(block, Ref<T>::GetStorageSize(), Ref<T>::GetStorageAlignment());
+		}
+
+		SizeClassAllocator* m_Allocator;
+	};
+}
\ No newline at end of file
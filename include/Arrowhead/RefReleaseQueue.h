@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace arwh
+{
+	struct RefReleaseStats
+	{
+		size_t Depth;			// Objects waiting to be released right now
+		size_t PeakDepth;
+		uint64_t Deferred;		// Objects that went through the queue
+		uint64_t Released;		// Objects the queue has released so far
+		uint64_t Overflowed;	// Releases that ran inline because the queue was full
+	};
+
+	// Opt-in deferred destruction for Ref. Threads that turn on SetDeferred push objects
+	// whose last reference they dropped onto a bounded lock-free ring instead of destroying
+	// them, and the queue gets drained later at a safe point or by a background reclaimer
+	// thread. When the ring is full the object is released inline like it would have been
+	// anyway. Objects from the non thread safe allocators in RefAllocator.h must only be
+	// drained on the thread that owns the allocator, so don't start the reclaimer for those
+	class RefReleaseQueue
+	{
+	public:
+		using ReleaseFn = void (*)(void* object);
+
+		// Capacity gets rounded up to a power of two. Dispose releases whatever is left, and
+		// no other thread can be releasing refs by the time it's called
+		static void Init(size_t capacity = DefaultCapacity);
+		static void Dispose();
+		static inline RefReleaseQueue* Get() { return s_Queue; }
+
+		// Per thread switch for whether last releases go through the queue
+		static inline void SetDeferred(bool deferred) { s_Deferred = deferred; }
+		static inline bool IsDeferred() { return s_Deferred; }
+
+		// Returns false when the caller has to release the object itself
+		static inline bool Defer(ReleaseFn release, void* object)
+		{
+			return s_Queue != nullptr && s_Queue->Push(release, object);
+		}
+
+		bool Push(ReleaseFn release, void* object);
+
+		// Releases up to maxCount objects and returns how many it got through. Only one thread
+		// drains at a time, anyone else calling this meanwhile just returns 0
+		size_t Drain(size_t maxCount = SIZE_MAX);
+
+		void StartReclaimer(std::chrono::milliseconds interval = DefaultReclaimInterval);
+		void StopReclaimer();
+
+		// Head first since the tail only ever moves ahead of it, still saturated because the two
+		// are separate loads that other threads can move in between
+		inline size_t GetDepth() const
+		{
+			size_t head = m_Head.load(std::memory_order_acquire);
+			size_t tail = m_Tail.load(std::memory_order_acquire);
+			return tail > head ? tail - head : 0;
+		}
+
+		inline size_t GetCapacity() const { return m_Mask + 1; }
+		RefReleaseStats GetStats() const;
+
+		static constexpr size_t DefaultCapacity = 4096;
+		static constexpr std::chrono::milliseconds DefaultReclaimInterval = std::chrono::milliseconds(1);
+
+	private:
+		RefReleaseQueue(size_t capacity);
+		~RefReleaseQueue();
+
+		struct Cell
+		{
+			// Tells producers and the consumer whose turn it is to use the cell
+			std::atomic<size_t> Sequence;
+			ReleaseFn Release;
+			void* Object;
+		};
+
+		void ReclaimerLoop(std::chrono::milliseconds interval);
+
+		Cell* m_Cells;
+		size_t m_Mask;
+
+		alignas(64) std::atomic<size_t> m_Tail = 0;
+		alignas(64) std::atomic<size_t> m_Head = 0;
+		std::mutex m_DrainMutex;
+
+		std::atomic<size_t> m_PeakDepth = 0;
+		std::atomic<uint64_t> m_Deferred = 0;
+		std::atomic<uint64_t> m_Released = 0;
+		std::atomic<uint64_t> m_Overflowed = 0;
+
+		std::thread m_Reclaimer;
+		std::mutex m_ReclaimerMutex;
+		std::condition_variable m_ReclaimerWake;
+		bool m_StopReclaimer = false;
+
+		inline static RefReleaseQueue* s_Queue = nullptr;
+		inline static thread_local bool s_Deferred = false;
+	};
+
+	// Defers every last release on this thread for as long as it's alive
+	class DeferredReleaseScope
+	{
+	public:
+		DeferredReleaseScope()
+			: m_WasDeferred(RefReleaseQueue::IsDeferred())
+		{
+			RefReleaseQueue::SetDeferred(true);
+		}
+
+		~DeferredReleaseScope()
+		{
+			RefReleaseQueue::SetDeferred(m_WasDeferred);
+		}
+
+		DeferredReleaseScope(const DeferredReleaseScope&) = delete;
+		DeferredReleaseScope& operator=(const DeferredReleaseScope&) = delete;
+
+	private:
+		bool m_WasDeferred;
+	};
+}
\ No newline at end of file
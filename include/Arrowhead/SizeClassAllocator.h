@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Arrowhead/Arena.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace arwh
+{
+	// General purpose small object allocator on top of an arena. Sizes are rounded up to a
+	// size class (multiples of 16 up to 64, then four steps per power of two) and every
+	// class carves its objects out of slabs pushed onto the arena and keeps its own free
+	// list. Anything bigger than MaxSize is pushed straight onto the arena and is only
+	// reclaimed when it's the last block or the arena gets cleared
+	class SizeClassAllocator
+	{
+	public:
+		SizeClassAllocator(Arena* arena, size_t slabSize = DefaultSlabSize);
+
+		SizeClassAllocator(const SizeClassAllocator&) = delete;
+		SizeClassAllocator& operator=(const SizeClassAllocator&) = delete;
+
+		// Free has to be given the same size and alignment the block was allocated with
+		void* Allocate(size_t size, size_t alignment = MinAlignment);
+		void Free(void* block, size_t size, size_t alignment = MinAlignment);
+
+		template<typename T>
+		T* Allocate() { return reinterpret_cast<T*>(Allocate(sizeof(T), alignof(T))); }
+		template<typename T>
+		void Free(T* value) { Free(value, sizeof(T), alignof(T)); }
+
+		// Forgets every slab, for when the arena has been set back past them
+		void Reset();
+
+		inline Arena* GetArena() const { return m_Arena; }
+
+		static size_t GetClassIndex(size_t size);
+		static size_t GetClassSize(size_t index);
+
+		static constexpr size_t MinAlignment = 16;
+		static constexpr size_t MaxSize = 16 * 1024;
+		static constexpr size_t ClassCount = 36;
+		static constexpr size_t DefaultSlabSize = 64 * 1024;
+
+	private:
+		struct FreeBlock
+		{
+			FreeBlock* Next;
+		};
+
+		struct SizeClass
+		{
+			FreeBlock* FirstFree;
+			uint8_t* Cursor;
+			uint8_t* End;
+		};
+
+		size_t GetClassIndex(size_t size, size_t alignment) const;
+		void* AllocateSlow(SizeClass& sizeClass, size_t index);
+
+		Arena* m_Arena;
+		size_t m_SlabSize;
+		SizeClass m_Classes[ClassCount];
+	};
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "Arrowhead/ArenaVector.h"
+#include "Arrowhead/Logger.h"
+
+#include <cstdint>
+#include <utility>
+
+namespace arwh
+{
+	// 32 bit reference into a SlotMap, the low IndexBits are the slot and the rest are the
+	// generation of the slot when it was handed out. Zero is never a valid handle
+	struct SlotHandle
+	{
+		uint32_t Value = 0;
+
+		inline bool IsNull() const { return Value == 0; }
+
+		bool operator==(const SlotHandle& other) const { return Value == other.Value; }
+		bool operator!=(const SlotHandle& other) const { return Value != other.Value; }
+	};
+
+	// Keeps its values packed together on an arena for iteration and hands out handles instead
+	// of pointers. Erasing moves the last value into the hole and bumps the generation of the
+	// slot, so any handle still pointing at it stops resolving instead of dangling
+	template<typename T, uint32_t IndexBits = 24>
+	class SlotMap
+	{
+	public:
+		static_assert(IndexBits > 0 && IndexBits < 32, "SlotMap needs bits for both the index and generation");
+
+		SlotMap(Arena* arena)
+			: m_Values(arena), m_DenseToSlot(arena), m_Slots(arena) {}
+
+		SlotMap(Arena* arena, size_t capacity)
+			: SlotMap(arena)
+		{
+			Reserve(capacity);
+		}
+
+		SlotMap(const SlotMap&) = delete;
+		SlotMap& operator=(const SlotMap&) = delete;
+
+		template<typename... Args>
+		SlotHandle Insert(Args&&... args)
+		{
+			uint32_t slotIndex = m_FirstFree;
+			if (slotIndex != NoSlot)
+				m_FirstFree = m_Slots[slotIndex].DenseIndex;
+			else
+			{
+				ARWH_CORE_ASSERT(m_Slots.GetSize() < MaxSlots, "SlotMap is out of slots");
+				slotIndex = static_cast<uint32_t>(m_Slots.GetSize());
+				m_Slots.PushBack({ 0, 1 });
+			}
+
+			Slot& slot = m_Slots[slotIndex];
+			slot.DenseIndex = static_cast<uint32_t>(m_Values.GetSize());
+			m_Values.EmplaceBack(std::forward<Args>(args)...);
+			m_DenseToSlot.PushBack(slotIndex);
+
+			return MakeHandle(slotIndex, slot.Generation);
+		}
+
+		bool Erase(SlotHandle handle)
+		{
+			uint32_t slotIndex = GetIndex(handle);
+			if (!IsCurrent(handle))
+				return false;
+
+			// Move the last value into the hole to keep everything packed
+			Slot& slot = m_Slots[slotIndex];
+			uint32_t last = static_cast<uint32_t>(m_Values.GetSize() - 1);
+			if (slot.DenseIndex != last)
+			{
+				m_Values[slot.DenseIndex] = std::move(m_Values[last]);
+				m_DenseToSlot[slot.DenseIndex] = m_DenseToSlot[last];
+				m_Slots[m_DenseToSlot[last]].DenseIndex = slot.DenseIndex;
+			}
+			m_Values.PopBack();
+			m_DenseToSlot.PopBack();
+
+			// A slot whose generation would wrap around is retired so old handles can never
+			// match it again
+			slot.Generation++;
+			if (slot.Generation <= MaxGeneration)
+			{
+				slot.DenseIndex = m_FirstFree;
+				m_FirstFree = slotIndex;
+			}
+			return true;
+		}
+
+		inline T* Get(SlotHandle handle)
+		{
+			return IsCurrent(handle) ? &m_Values[m_Slots[GetIndex(handle)].DenseIndex] : nullptr;
+		}
+
+		inline const T* Get(SlotHandle handle) const
+		{
+			return IsCurrent(handle) ? &m_Values[m_Slots[GetIndex(handle)].DenseIndex] : nullptr;
+		}
+
+		inline bool Contains(SlotHandle handle) const { return IsCurrent(handle); }
+
+		// Handle of the value at a position in the packed array, for use while iterating
+		inline SlotHandle GetHandle(size_t denseIndex) const
+		{
+			uint32_t slotIndex = m_DenseToSlot[denseIndex];
+			return MakeHandle(slotIndex, m_Slots[slotIndex].Generation);
+		}
+
+		void Reserve(size_t count)
+		{
+			m_Values.Reserve(count);
+			m_DenseToSlot.Reserve(count);
+			m_Slots.Reserve(count);
+		}
+
+		void Clear()
+		{
+			// Erasing one by one keeps the generations moving so every old handle goes stale
+			while (!m_Values.IsEmpty())
+				Erase(GetHandle(m_Values.GetSize() - 1));
+		}
+
+		inline size_t GetSize() const { return m_Values.GetSize(); }
+		inline bool IsEmpty() const { return m_Values.IsEmpty(); }
+
+		inline T* Data() { return m_Values.Data(); }
+		inline const T* Data() const { return m_Values.Data(); }
+
+		inline T* begin() { return m_Values.Data(); }
+		inline T* end() { return m_Values.Data() + m_Values.GetSize(); }
+		inline const T* begin() const { return m_Values.Data(); }
+		inline const T* end() const { return m_Values.Data() + m_Values.GetSize(); }
+
+		static constexpr uint32_t MaxSlots = uint32_t(1) << IndexBits;
+		static constexpr uint32_t MaxGeneration = (uint32_t(1) << (32 - IndexBits)) - 1;
+
+	private:
+		struct Slot
+		{
+			// Index into the packed arrays while in use, the next free slot otherwise
+			uint32_t DenseIndex;
+			uint32_t Generation;
+		};
+
+		static constexpr uint32_t NoSlot = ~uint32_t(0);
+		static constexpr uint32_t IndexMask = MaxSlots - 1;
+
+		static inline SlotHandle MakeHandle(uint32_t index, uint32_t generation) { return { index | (generation << IndexBits) }; }
+		static inline uint32_t GetIndex(SlotHandle handle) { return handle.Value & IndexMask; }
+		static inline uint32_t GetGeneration(SlotHandle handle) { return handle.Value >> IndexBits; }
+
+		inline bool IsCurrent(SlotHandle handle) const
+		{
+			uint32_t index = GetIndex(handle);
+			return index < m_Slots.GetSize() && m_Slots[index].Generation == GetGeneration(handle);
+		}
+
+		ArenaVector<T> m_Values;
+		ArenaVector<uint32_t> m_DenseToSlot;
+		ArenaVector<Slot> m_Slots;
+		uint32_t m_FirstFree = NoSlot;
+	};
+}
@@ -46,8 +46,8 @@ project "Arrowhead"
     filter "system:linux"
         files
         {
-			"%{prj.name}/src/Arrow/Platform/Linux/**.h",
-			"%{prj.name}/src/Arrow/Platform/Linux/**.cpp"
+			"src/Platform/Linux/**.h",
+			"src/Platform/Linux/**.cpp"
         }
 
         links
@@ -66,9 +66,9 @@ project "Arrowhead"
 
 		files
 		{
-			"%{prj.name}/src/Arrow/Platform/MacOS/**.h",
-			"%{prj.name}/src/Arrow/Platform/MacOS/**.cpp",
-			"%{prj.name}/src/Arrow/Platform/MacOS/**.mm"
+			"src/Platform/MacOS/**.h",
+			"src/Platform/MacOS/**.cpp",
+			"src/Platform/MacOS/**.mm"
 		}
 
         links
@@ -83,7 +83,85 @@ project "Arrowhead"
 		}
 
     filter "configurations:Debug"
-        defines "ARWH_DEBUG"
+        defines { "ARWH_DEBUG", "ARWH_ARENA_STATS" }
+        runtime "Debug"
+        symbols "on"
+
+    filter "configurations:Release"
+        defines "ARWH_RELEASE"
+        runtime "Release"
+        optimize "Speed"
+
+    filter "configurations:Dist"
+        defines "ARWH_DIST"
+        runtime "Release"
+        optimize "Speed"
+        symbols "off"
+
+project "ArrowheadBenchmarks"
+    language "C++"
+    cppdialect "C++17"
+    kind "ConsoleApp"
+
+    staticruntime "on"
+    systemversion "latest"
+
+    targetdir (TARGET_DIR)
+	objdir (OBJ_DIR)
+
+    files
+    {
+        "benchmarks/**.h",
+		"benchmarks/**.cpp"
+    }
+
+    includedirs
+    {
+        "benchmarks",
+        "include"
+    }
+
+    links
+    {
+        "Arrowhead"
+    }
+
+    filter "system:windows"
+        defines
+		{
+			"ARWH_WINDOWS",
+			"ARWH_MSVC"
+		}
+
+    filter "system:linux"
+        links
+        {
+            "xcb",
+			"pthread"
+        }
+
+        defines
+        {
+            "ARWH_LINUX",
+			"ARWH_GCC"
+        }
+
+    filter "system:macosx"
+		systemversion "12.7:latest"
+
+        links
+		{
+			"Cocoa.framework"
+		}
+
+		defines
+		{
+			"ARWH_MACOS",
+			"ARWH_CLANG"
+		}
+
+    filter "configurations:Debug"
+        defines { "ARWH_DEBUG", "ARWH_ARENA_STATS" }
         runtime "Debug"
         symbols "on"
 
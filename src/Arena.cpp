@@ -2,38 +2,197 @@
 
 #include "Arrowhead/Logger.h"
 
+#include "VirtualMemory.h"
+
+#include <algorithm>
 #include <cstring>
 
-constexpr size_t ScratchSize = 1024 * 1024;
+#ifdef ARWH_ARENA_STATS
+#include <mutex>
+
+#define ARWH_ARENA_TRACK_PUSH() { m_PushCount.store(m_PushCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); PublishPosition(); }
+#define ARWH_ARENA_TRACK_POS() PublishPosition()
+#define ARWH_ARENA_TRACK_GROW() m_GrowCount.store(m_GrowCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed)
+#define ARWH_ARENA_REGISTER(arena) (arena)->Register()
+#define ARWH_ARENA_UNREGISTER(arena) (arena)->Unregister()
+#else
+#define ARWH_ARENA_TRACK_PUSH()
+#define ARWH_ARENA_TRACK_POS()
+#define ARWH_ARENA_TRACK_GROW()
+#define ARWH_ARENA_REGISTER(arena)
+#define ARWH_ARENA_UNREGISTER(arena)
+#endif
 
 namespace arwh
 {
-	Arena::Arena(size_t size)
-		: m_TotalSize(size)
+#ifdef ARWH_ARENA_STATS
+	static std::mutex s_LiveArenasMutex;
+	static Arena* s_LiveArenas = nullptr;
+#endif
+
+	static const char* const s_ScratchNames[Arena::MaxScratchCount] =
+	{
+		"Scratch 0", "Scratch 1", "Scratch 2", "Scratch 3", "Scratch 4", "Scratch 5", "Scratch 6", "Scratch 7"
+	};
+
+	static inline size_t AlignUp(size_t value, size_t alignment)
+	{
+		return ((value + alignment - 1) / alignment) * alignment;
+	}
+
+	Arena::Arena(size_t size, ArenaMode mode)
+		: m_TotalSize(size), m_Mode(mode)
 	{
 		// This constructor assumes that the data block is allocated right after the arena structure
 		m_Data = reinterpret_cast<uint8_t*>(this + 1);
 		m_Position = m_Data;
+		m_End = m_Data + size;
+	}
+
+	static inline size_t GetPadding(const uint8_t* position, size_t alignment)
+	{
+		return (0 - reinterpret_cast<uintptr_t>(position)) & (alignment - 1);
 	}
 
 	void* Arena::Push(size_t size)
 	{
-		// Check for overflow
-		m_AllocatedSize += size;
-		ARWH_CORE_ASSERT(m_AllocatedSize < m_TotalSize, "Arena pushed out of bounds");
+		// Anything that doesn't fit in the usable memory has to grow the arena first
+		if (size > static_cast<size_t>(m_End - m_Position))
+			Grow(size, 1);
 
 		// Increment internal pointer and return the block
 		void* block = m_Position;
 		m_Position += size;
+		m_AllocatedSize += size;
+		ARWH_ARENA_TRACK_PUSH();
+		return block;
+	}
+
+	void* Arena::PushAligned(size_t size, size_t alignment)
+	{
+		size_t padding = GetPadding(m_Position, alignment);
+		if (padding + size > static_cast<size_t>(m_End - m_Position))
+		{
+			// Growing can move the position to a new block so the padding has to be worked out again
+			Grow(size, alignment);
+			padding = GetPadding(m_Position, alignment);
+		}
+
+		void* block = m_Position + padding;
+		m_Position += padding + size;
+		m_AllocatedSize += padding + size;
+		ARWH_ARENA_TRACK_PUSH();
 		return block;
 	}
 
+	bool Arena::Extend(void* block, size_t size, size_t newSize)
+	{
+		if (!IsLast(block, size))
+			return false;
+
+		size_t extra = newSize - size;
+		if (extra > static_cast<size_t>(m_End - m_Position))
+		{
+			// Only a reserved arena can make more room right after the block
+			if (m_Mode != ArenaMode::Reserved || extra > m_TotalSize - m_AllocatedSize)
+				return false;
+			Grow(extra, 1);
+		}
+
+		m_Position += extra;
+		m_AllocatedSize += extra;
+		ARWH_ARENA_TRACK_PUSH();
+		return true;
+	}
+
+	void Arena::Grow(size_t size, size_t alignment)
+	{
+		// Check for overflow
+		ARWH_CORE_ASSERT(m_Mode != ArenaMode::Fixed, "Arena pushed out of bounds");
+		ARWH_ARENA_TRACK_GROW();
+
+		if (m_Mode == ArenaMode::Chained)
+		{
+			// Where the block starts isn't known yet so leave room for the worst case padding
+			PushBlock(size + alignment - 1);
+			return;
+		}
+
+		size += GetPadding(m_Position, alignment);
+		ARWH_CORE_ASSERT(size <= m_TotalSize - m_AllocatedSize, "Arena pushed past its reserved address range");
+
+		// Commit enough whole steps to fit the block, offsets are taken from the start of
+		// the reservation because that is the only address that is known to be page aligned
+		uint8_t* base = reinterpret_cast<uint8_t*>(this);
+		size_t reservedSize = static_cast<size_t>(m_Data - base) + m_TotalSize;
+		size_t newEnd = std::min(AlignUp(static_cast<size_t>(m_Position - base) + size, m_CommitSize), reservedSize);
+
+		bool committed = VirtualMemory::Commit(m_End, newEnd - static_cast<size_t>(m_End - base));
+		ARWH_CORE_ASSERT(committed, "Arena failed to commit memory");
+		m_End = base + newEnd;
+	}
+
+	void Arena::PushBlock(size_t size)
+	{
+		// Reuse a recycled block that is big enough before allocating a new one
+		Block** link = &m_FreeBlocks;
+		while (*link != nullptr && (*link)->Size < size)
+			link = &(*link)->Prev;
+
+		Block* block = *link;
+		if (block != nullptr)
+			*link = block->Prev;
+		else
+		{
+			size_t blockSize = std::max(size, m_TotalSize);
+			block = reinterpret_cast<Block*>(std::malloc(sizeof(Block) + blockSize));
+			ARWH_CORE_ASSERT(block != nullptr, "Arena failed to allocate a new block");
+			block->Size = blockSize;
+		}
+
+		// The rest of the old block is skipped so positions stay continuous across blocks
+		block->Prev = m_Block;
+		block->BasePos = m_AllocatedSize;
+
+		m_Block = block;
+		m_BlockBase = block->BasePos;
+		m_Data = block->GetData();
+		m_Position = m_Data;
+		m_End = m_Data + block->Size;
+	}
+
+	void Arena::PopBlock(bool release)
+	{
+		Block* block = m_Block;
+		m_Block = block->Prev;
+
+		if (release)
+			free(block);
+		else
+		{
+			block->Prev = m_FreeBlocks;
+			m_FreeBlocks = block;
+		}
+
+		if (m_Block != nullptr)
+		{
+			m_BlockBase = m_Block->BasePos;
+			m_Data = m_Block->GetData();
+			m_End = m_Data + m_Block->Size;
+		}
+		else
+		{
+			m_BlockBase = 0;
+			m_Data = reinterpret_cast<uint8_t*>(this + 1);
+			m_End = m_Data + m_TotalSize;
+		}
+	}
+
 	void Arena::Pop(size_t size)
 	{
 		// Prevent the position from 'popping' past the start
 		size = std::min(size, m_AllocatedSize);
-		m_AllocatedSize -= size;
-		m_Position -= size;
+		SetPosBack(m_AllocatedSize - size);
 	}
 
 	void* Arena::PushZero(size_t size)
@@ -44,48 +203,321 @@ namespace arwh
 		return block;
 	}
 
-	void Arena::SetPosBack(size_t pos)
+	void* Arena::PushAlignedZero(size_t size, size_t alignment)
+	{
+		void* block = PushAligned(size, alignment);
+		memset(block, 0, size);
+		return block;
+	}
+
+	void Arena::AddDestructor(Destructor* destructor, void (*destroy)(void*, size_t), void* objects, size_t count)
+	{
+		destructor->Next = m_Destructors;
+		destructor->Destroy = destroy;
+		destructor->Objects = objects;
+		destructor->Count = count;
+		destructor->EndPos = m_AllocatedSize;
+		m_Destructors = destructor;
+	}
+
+	void Arena::RunDestructors(size_t pos)
+	{
+		// The list is in push order so it can stop at the first object that is still in use
+		while (m_Destructors != nullptr && m_Destructors->EndPos > pos)
+		{
+			Destructor* destructor = m_Destructors;
+			m_Destructors = destructor->Next;
+			destructor->Destroy(destructor->Objects, destructor->Count);
+		}
+	}
+
+	void Arena::SetPosBack(size_t pos, bool release)
 	{
 		// Prevent overflow
-		ARWH_CORE_ASSERT(pos < m_TotalSize, "Arena set pos must be inside the bounds");
+		ARWH_CORE_ASSERT(pos <= m_AllocatedSize, "Arena set pos must be behind the current position");
+
+		// Objects have to be destroyed before any of the blocks they live in are freed
+		if (m_Destructors != nullptr)
+			RunDestructors(pos);
+
 		m_AllocatedSize = pos;
-		m_Position = m_Data + pos;
+		ARWH_ARENA_TRACK_POS();
+
+		if (m_Mode == ArenaMode::Chained)
+		{
+			// Unlink every block that starts at or after the new position
+			while (m_Block != nullptr && m_Block->BasePos >= pos)
+				PopBlock(release);
+
+			if (release)
+			{
+				while (m_FreeBlocks != nullptr)
+				{
+					Block* block = m_FreeBlocks;
+					m_FreeBlocks = block->Prev;
+					free(block);
+				}
+			}
+		}
+
+		m_Position = m_Data + (pos - m_BlockBase);
+
+		if (release && m_Mode == ArenaMode::Reserved)
+		{
+			// Keep the commit step that the position is in and decommit everything after it
+			uint8_t* base = reinterpret_cast<uint8_t*>(this);
+			uint8_t* keepEnd = base + AlignUp(static_cast<size_t>(m_Position - base), m_CommitSize);
+			if (keepEnd < m_End)
+			{
+				VirtualMemory::Decommit(keepEnd, static_cast<size_t>(m_End - keepEnd));
+				m_End = keepEnd;
+			}
+		}
 	}
 
-	void Arena::Clear()
+	void Arena::Clear(bool release)
 	{
-		m_AllocatedSize = 0;
-		m_Position = m_Data;
+		SetPosBack(0, release);
 	}
 
 	// This function causes a buffer overun warning that shouldn't actually be a problem
 #pragma warning( push )
 #pragma warning( disable : 6386)
-	Arena* Arena::Create(size_t size)
+	Arena* Arena::Create(size_t size, ArenaBacking backing)
 	{
 		// Allocate the memory block with an arena structure at the beginning
 		size_t bufferSize = sizeof(Arena) + size;
-		void* buffer = std::malloc(bufferSize);
-		return new(buffer) Arena(size);
+
+		if (backing == ArenaBacking::Heap)
+		{
+			void* buffer = std::malloc(bufferSize);
+			Arena* arena = new(buffer) Arena(size, ArenaMode::Fixed);
+			ARWH_ARENA_REGISTER(arena);
+			return arena;
+		}
+
+		// Step down through the backings until one of them works out
+		void* buffer = nullptr;
+		if (backing == ArenaBacking::HugeTLB)
+		{
+			bufferSize = AlignUp(bufferSize, VirtualMemory::GetHugePageSize());
+			buffer = VirtualMemory::AllocateHuge(bufferSize);
+			if (buffer == nullptr)
+				backing = ArenaBacking::TransparentHugePages;
+		}
+
+		if (buffer == nullptr)
+		{
+			size_t pageSize = backing == ArenaBacking::TransparentHugePages ? VirtualMemory::GetHugePageSize() : VirtualMemory::GetPageSize();
+			bufferSize = AlignUp(bufferSize, pageSize);
+
+			buffer = VirtualMemory::Reserve(bufferSize);
+			ARWH_CORE_ASSERT(buffer != nullptr, "Arena failed to reserve address space");
+
+			// The advice has to be given before the pages are touched for the first time
+			if (backing == ArenaBacking::TransparentHugePages && !VirtualMemory::AdviseHugePages(buffer, bufferSize))
+				backing = ArenaBacking::Pages;
+
+			bool committed = VirtualMemory::Commit(buffer, bufferSize);
+			ARWH_CORE_ASSERT(committed, "Arena failed to commit memory");
+		}
+
+		Arena* arena = new(buffer) Arena(bufferSize - sizeof(Arena), ArenaMode::Fixed);
+		arena->m_Backing = backing;
+		ARWH_ARENA_REGISTER(arena);
+		return arena;
 	}
 #pragma warning( pop )
 
-	void Arena::InitScratch()
+	Arena* Arena::CreateReserved(size_t reserveSize, size_t commitSize)
+	{
+		size_t pageSize = VirtualMemory::GetPageSize();
+		commitSize = AlignUp(std::max<size_t>(commitSize, 1), pageSize);
+		size_t reservedSize = AlignUp(sizeof(Arena) + reserveSize, pageSize);
+
+		void* buffer = VirtualMemory::Reserve(reservedSize);
+		ARWH_CORE_ASSERT(buffer != nullptr, "Arena failed to reserve address space");
+
+		// The first commit step also holds the arena structure
+		size_t initialCommit = std::min(commitSize, reservedSize);
+		bool committed = VirtualMemory::Commit(buffer, initialCommit);
+		ARWH_CORE_ASSERT(committed, "Arena failed to commit memory");
+
+		Arena* arena = new(buffer) Arena(reservedSize - sizeof(Arena), ArenaMode::Reserved);
+		arena->m_Backing = ArenaBacking::Pages;
+		arena->m_End = reinterpret_cast<uint8_t*>(buffer) + initialCommit;
+		arena->m_CommitSize = commitSize;
+		ARWH_ARENA_REGISTER(arena);
+		return arena;
+	}
+
+	Arena* Arena::CreateChained(size_t blockSize)
+	{
+		void* buffer = std::malloc(sizeof(Arena) + blockSize);
+		ARWH_CORE_ASSERT(buffer != nullptr, "Arena failed to allocate its first block");
+		Arena* arena = new(buffer) Arena(blockSize, ArenaMode::Chained);
+		ARWH_ARENA_REGISTER(arena);
+		return arena;
+	}
+
+	void Arena::Dispose(Arena* arena)
+	{
+		if (arena == nullptr)
+			return;
+
+		ARWH_ARENA_UNREGISTER(arena);
+
+		// Destroys anything that is left and frees all of the linked blocks of a chained arena
+		arena->Clear(arena->m_Mode == ArenaMode::Chained);
+
+		if (arena->m_Backing != ArenaBacking::Heap)
+			VirtualMemory::Release(arena, sizeof(Arena) + arena->m_TotalSize);
+		else
+			free(arena);
+	}
+
+	ArenaStats Arena::GetStats() const
+	{
+		ArenaStats stats = ArenaStats();
+		stats.Mode = m_Mode;
+		stats.Backing = m_Backing;
+		stats.Capacity = m_TotalSize;
+		stats.Position = m_AllocatedSize;
+		stats.Name = GetName();
+#ifdef ARWH_ARENA_STATS
+		stats.PeakPosition = m_PeakSize.load(std::memory_order_relaxed);
+		stats.PushCount = m_PushCount.load(std::memory_order_relaxed);
+		stats.GrowCount = m_GrowCount.load(std::memory_order_relaxed);
+#endif
+		return stats;
+	}
+
+	ArenaStats Arena::GetPublishedStats() const
+	{
+		// Mode, backing and capacity never change after the arena is registered, everything
+		// else is read from the atomics the owner publishes
+		ArenaStats stats = ArenaStats();
+		stats.Name = GetName();
+		stats.Mode = m_Mode;
+		stats.Backing = m_Backing;
+		stats.Capacity = m_TotalSize;
+		stats.Position = m_PublishedSize.load(std::memory_order_relaxed);
+		stats.PeakPosition = m_PeakSize.load(std::memory_order_relaxed);
+		stats.PushCount = m_PushCount.load(std::memory_order_relaxed);
+		stats.GrowCount = m_GrowCount.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	std::vector<ArenaStats> Arena::GetLiveStats()
+	{
+		std::vector<ArenaStats> stats;
+#ifdef ARWH_ARENA_STATS
+		// The numbers of arenas owned by other threads can be slightly stale, they're only read
+		std::lock_guard<std::mutex> lock(s_LiveArenasMutex);
+		for (Arena* arena = s_LiveArenas; arena != nullptr; arena = arena->m_NextLive)
+			stats.push_back(arena->GetPublishedStats());
+#endif
+		return stats;
+	}
+
+	void Arena::LogLiveStats()
+	{
+#ifdef ARWH_ARENA_STATS
+		for (const ArenaStats& stats : GetLiveStats())
+		{
+			ARWH_LOG_TAG_CORE_INFO("Arena", stats.Name, ": ", stats.Position, '/', stats.Capacity, " bytes, peak ", stats.PeakPosition,
+				", ", stats.PushCount, " pushes, ", stats.GrowCount, " grows");
+		}
+#endif
+	}
+
+#ifdef ARWH_ARENA_STATS
+	void Arena::PublishPosition()
+	{
+		m_PublishedSize.store(m_AllocatedSize, std::memory_order_relaxed);
+		if (m_AllocatedSize > m_PeakSize.load(std::memory_order_relaxed))
+			m_PeakSize.store(m_AllocatedSize, std::memory_order_relaxed);
+	}
+
+	void Arena::Register()
+	{
+		std::lock_guard<std::mutex> lock(s_LiveArenasMutex);
+		m_NextLive = s_LiveArenas;
+		if (s_LiveArenas != nullptr)
+			s_LiveArenas->m_PrevLive = this;
+		s_LiveArenas = this;
+	}
+
+	void Arena::Unregister()
+	{
+		std::lock_guard<std::mutex> lock(s_LiveArenasMutex);
+		if (m_PrevLive != nullptr)
+			m_PrevLive->m_NextLive = m_NextLive;
+		else
+			s_LiveArenas = m_NextLive;
+
+		if (m_NextLive != nullptr)
+			m_NextLive->m_PrevLive = m_PrevLive;
+	}
+#endif
+
+	void Arena::InitScratch(ArenaBacking backing, uint32_t count, size_t size)
+	{
+		ARWH_CORE_ASSERT(count > 0 && count <= MaxScratchCount, "Scratch arena count must be between 1 and MaxScratchCount");
+
+		if (s_ScratchCount == 0)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				s_Scratch[i] = Arena::Create(size, backing);
+				s_Scratch[i]->SetName(s_ScratchNames[i]);
+			}
+			s_ScratchCount = count;
+		}
+	}
+
+	void Arena::DisposeScratch()
 	{
-		if (s_TempScratch == nullptr && s_PersistentScratch == nullptr)
+		for (uint32_t i = 0; i < s_ScratchCount; i++)
 		{
-			s_TempScratch = Arena::Create(ScratchSize);
-			s_PersistentScratch = Arena::Create(ScratchSize);
+			Dispose(s_Scratch[i]);
+			s_Scratch[i] = nullptr;
 		}
+		s_ScratchCount = 0;
+	}
+
+	Arena* Arena::GetScratchExcluding(Arena* const* conflicts, size_t conflictCount)
+	{
+		for (uint32_t i = 0; i < s_ScratchCount; i++)
+		{
+			Arena* scratch = s_Scratch[i];
+
+			bool conflicting = false;
+			for (size_t j = 0; j < conflictCount && !conflicting; j++)
+				conflicting = conflicts[j] == scratch;
+
+			if (!conflicting)
+				return scratch;
+		}
+
+		ARWH_CORE_ASSERT(false, "Every scratch arena on this thread conflicts");
+		return nullptr;
 	}
 
 
 	ScratchSpace::ScratchSpace(Arena* arena)
 		: m_Arena(arena), m_ResetPos(arena->GetPos()), m_HasReset(false) { }
 
+	ScratchSpace::~ScratchSpace()
+	{
+		Reset();
+	}
+
 	void ScratchSpace::Reset()
 	{
-		m_Arena->SetPosBack(m_ResetPos);
+		// Something inside the scope may have cleared the arena or set it back further already
+		if (m_ResetPos <= m_Arena->GetPos())
+			m_Arena->SetPosBack(m_ResetPos);
+		m_HasReset = true;
 	}
 }
-
@@ -0,0 +1,123 @@
+#include "Arrowhead/ArenaSnapshot.h"
+
+#include "Arrowhead/Logger.h"
+
+#include "VirtualMemory.h"
+
+#include <cstring>
+#include <fstream>
+
+constexpr uint64_t SnapshotMagic = 0x50414E5348575241; // "ARWHSNAP" read as a little endian integer
+constexpr size_t SnapshotAlignment = 64;
+
+namespace arwh
+{
+	ArenaSnapshot::~ArenaSnapshot()
+	{
+		Unload();
+	}
+
+	bool ArenaSnapshot::Save(const Arena* arena, const std::string& path, const void* root, uint32_t version)
+	{
+		static_assert(sizeof(Header) == SnapshotAlignment, "Snapshot header has to stay one alignment step long");
+		ARWH_CORE_ASSERT(arena->IsContiguous(), "Only contiguous arenas can be saved as a snapshot");
+
+		const uint8_t* data = arena->GetData();
+		size_t size = arena->GetPos();
+
+		Header header = Header();
+		header.Magic = SnapshotMagic;
+		header.FormatVersion = FormatVersion;
+		header.Version = version;
+		header.Size = size;
+		if (root != nullptr)
+		{
+			ARWH_CORE_ASSERT(root >= data && root < data + size, "Snapshot root has to point into the arena's used range");
+			header.RootOffset = static_cast<uint64_t>(static_cast<const uint8_t*>(root) - data);
+		}
+		else
+			header.RootOffset = NullRoot;
+
+		// Pad the data so it lands at the same alignment it had in the arena once it's mapped
+		header.DataPadding = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(data) % SnapshotAlignment);
+		header.Checksum = Checksum(header, data);
+		char padding[SnapshotAlignment] = {};
+
+		std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.write(padding, header.DataPadding);
+		file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+		return file.good();
+	}
+
+	bool ArenaSnapshot::Load(const std::string& path, uint32_t version, bool verify)
+	{
+		Unload();
+
+		size_t mappingSize = 0;
+		const void* mapping = VirtualMemory::MapFile(path.c_str(), &mappingSize);
+		if (mapping == nullptr)
+			return false;
+
+		// Sizes are compared by subtracting so a huge Size in a corrupt file can't wrap around
+		const Header* header = reinterpret_cast<const Header*>(mapping);
+		bool valid = mappingSize >= sizeof(Header) && header->Magic == SnapshotMagic &&
+			header->FormatVersion == FormatVersion && header->Version == version &&
+			header->DataPadding < SnapshotAlignment && header->DataPadding <= mappingSize - sizeof(Header) &&
+			header->Size <= mappingSize - sizeof(Header) - header->DataPadding &&
+			(header->RootOffset < header->Size || header->RootOffset == NullRoot);
+
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(header + 1) + (valid ? header->DataPadding : 0);
+		if (valid && verify)
+			valid = Checksum(*header, data) == header->Checksum;
+
+		if (!valid)
+		{
+			VirtualMemory::UnmapFile(mapping, mappingSize);
+			return false;
+		}
+
+		m_Mapping = mapping;
+		m_MappingSize = mappingSize;
+		m_Data = data;
+		m_Size = header->Size;
+		m_RootOffset = header->RootOffset;
+		return true;
+	}
+
+	void ArenaSnapshot::Unload()
+	{
+		if (m_Mapping != nullptr)
+			VirtualMemory::UnmapFile(m_Mapping, m_MappingSize);
+
+		m_Mapping = nullptr;
+		m_MappingSize = 0;
+		m_Data = nullptr;
+		m_Size = 0;
+		m_RootOffset = NullRoot;
+	}
+
+	uint64_t ArenaSnapshot::Checksum(const Header& header, const uint8_t* data)
+	{
+		// Covers the data and every header field apart from the checksum itself
+		Header copy = header;
+		copy.Checksum = 0;
+		uint64_t hash = Checksum(reinterpret_cast<const uint8_t*>(&copy), sizeof(Header), 0xCBF29CE484222325);
+		return Checksum(data, header.Size, hash);
+	}
+
+	uint64_t ArenaSnapshot::Checksum(const uint8_t* data, size_t size, uint64_t hash)
+	{
+		// FNV-1a over whole words, this only has to catch corrupt or truncated files
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(uint64_t));
+			hash = (hash ^ word) * 0x100000001B3;
+		}
+		for (; i < size; i++)
+			hash = (hash ^ data[i]) * 0x100000001B3;
+		return hash;
+	}
+}
@@ -0,0 +1,102 @@
+#include "Arrowhead/ArenaString.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace arwh
+{
+	ArenaString ArenaString::Copy(Arena* arena, const char* data, size_t size)
+	{
+		char* buffer = arena->PushArray<char>(size + 1);
+		memcpy(buffer, data, size);
+		buffer[size] = '\0';
+		return ArenaString(buffer, size);
+	}
+
+	ArenaString ArenaString::Format(Arena* arena, const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		ArenaString string = FormatList(arena, format, args);
+		va_end(args);
+		return string;
+	}
+
+	ArenaString ArenaString::FormatList(Arena* arena, const char* format, va_list args)
+	{
+		// Measure first so the exact size can be pushed
+		va_list measureArgs;
+		va_copy(measureArgs, args);
+		int size = vsnprintf(nullptr, 0, format, measureArgs);
+		va_end(measureArgs);
+
+		if (size <= 0)
+			return ArenaString();
+
+		char* buffer = arena->PushArray<char>(static_cast<size_t>(size) + 1);
+		vsnprintf(buffer, static_cast<size_t>(size) + 1, format, args);
+		return ArenaString(buffer, static_cast<size_t>(size));
+	}
+
+
+	ArenaStringBuilder::ArenaStringBuilder(Arena* arena, size_t capacity)
+		: m_Arena(arena), m_Data(arena->PushArray<char>(capacity)), m_Size(0), m_Capacity(capacity) {}
+
+	ArenaStringBuilder& ArenaStringBuilder::Append(const char* data, size_t size)
+	{
+		Reserve(m_Size + size);
+		memcpy(m_Data + m_Size, data, size);
+		m_Size += size;
+		return *this;
+	}
+
+	ArenaStringBuilder& ArenaStringBuilder::AppendFormat(const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		AppendFormatList(format, args);
+		va_end(args);
+		return *this;
+	}
+
+	ArenaStringBuilder& ArenaStringBuilder::AppendFormatList(const char* format, va_list args)
+	{
+		// Try to format straight into the spare capacity and only measure when it doesn't fit
+		va_list retryArgs;
+		va_copy(retryArgs, args);
+		int size = vsnprintf(m_Data + m_Size, m_Capacity - m_Size, format, args);
+
+		if (size > 0 && m_Size + static_cast<size_t>(size) >= m_Capacity)
+		{
+			Reserve(m_Size + static_cast<size_t>(size) + 1);
+			vsnprintf(m_Data + m_Size, m_Capacity - m_Size, format, retryArgs);
+		}
+		va_end(retryArgs);
+
+		if (size > 0)
+			m_Size += static_cast<size_t>(size);
+		return *this;
+	}
+
+	ArenaString ArenaStringBuilder::ToString()
+	{
+		Reserve(m_Size + 1);
+		m_Data[m_Size] = '\0';
+		return ArenaString(m_Data, m_Size);
+	}
+
+	void ArenaStringBuilder::Reserve(size_t size)
+	{
+		if (size <= m_Capacity)
+			return;
+
+		size_t capacity = std::max(size, m_Capacity * 2);
+		if (!m_Arena->Extend(m_Data, m_Capacity, capacity))
+		{
+			char* data = m_Arena->PushArray<char>(capacity);
+			memcpy(data, m_Data, m_Size);
+			m_Data = data;
+		}
+		m_Capacity = capacity;
+	}
+}
@@ -0,0 +1,134 @@
+#include "Arrowhead/ConcurrentArena.h"
+
+#include "Arrowhead/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace arwh
+{
+	static inline size_t AlignUp(size_t value, size_t alignment)
+	{
+		return ((value + alignment - 1) / alignment) * alignment;
+	}
+
+	ConcurrentArena::ConcurrentArena(size_t chunkSize)
+		: m_Current(AllocateChunk(AlignUp(chunkSize, MinAlignment))), m_LargeChunks(nullptr),
+		m_ChunkSize(AlignUp(chunkSize, MinAlignment)) {}
+
+	ConcurrentArena::~ConcurrentArena()
+	{
+		FreeChunks(m_Current.load());
+		FreeChunks(m_LargeChunks.load());
+	}
+
+	void* ConcurrentArena::Push(size_t size)
+	{
+		// Keeping every size a multiple of the minimum alignment keeps every offset aligned too
+		size = AlignUp(size, MinAlignment);
+
+		Chunk* chunk = m_Current.load(std::memory_order_acquire);
+		size_t offset = chunk->Offset.fetch_add(size, std::memory_order_relaxed);
+		if (offset + size <= chunk->Size)
+			return chunk->GetData() + offset;
+
+		return PushSlow(chunk, size);
+	}
+
+	void* ConcurrentArena::PushZero(size_t size)
+	{
+		void* block = Push(size);
+		memset(block, 0, size);
+		return block;
+	}
+
+	void* ConcurrentArena::PushAligned(size_t size, size_t alignment)
+	{
+		if (alignment <= MinAlignment)
+			return Push(size);
+
+		// Over allocate since the offset the block lands at isn't known ahead of time
+		uintptr_t block = reinterpret_cast<uintptr_t>(Push(size + alignment - MinAlignment));
+		return reinterpret_cast<void*>((block + alignment - 1) & ~(alignment - 1));
+	}
+
+	void* ConcurrentArena::PushSlow(Chunk* chunk, size_t size)
+	{
+		// Blocks that are too big for a chunk get their own so the current chunk isn't wasted
+		if (size > m_ChunkSize)
+			return PushLarge(size);
+
+		for (uint32_t attempt = 0; attempt < MaxGrowAttempts; attempt++)
+		{
+			Chunk* current = m_Current.load(std::memory_order_acquire);
+			if (current == chunk)
+			{
+				// Try to link a new chunk on with this block already taken out of it
+				Chunk* next = AllocateChunk(m_ChunkSize);
+				next->Offset.store(size, std::memory_order_relaxed);
+				next->Prev = chunk;
+
+				if (m_Current.compare_exchange_strong(current, next, std::memory_order_acq_rel, std::memory_order_acquire))
+					return next->GetData();
+
+				// Another thread got there first so try its chunk instead
+				next->Prev = nullptr;
+				FreeChunks(next);
+			}
+
+			chunk = current;
+			size_t offset = chunk->Offset.fetch_add(size, std::memory_order_relaxed);
+			if (offset + size <= chunk->Size)
+				return chunk->GetData() + offset;
+		}
+
+		ARWH_CORE_ASSERT(false, "ConcurrentArena ran out of attempts to grow");
+		return nullptr;
+	}
+
+	void* ConcurrentArena::PushLarge(size_t size)
+	{
+		Chunk* chunk = AllocateChunk(size);
+		chunk->Offset.store(size, std::memory_order_relaxed);
+
+		Chunk* head = m_LargeChunks.load(std::memory_order_relaxed);
+		do
+			chunk->Prev = head;
+		while (!m_LargeChunks.compare_exchange_weak(head, chunk, std::memory_order_release, std::memory_order_relaxed));
+
+		return chunk->GetData();
+	}
+
+	void ConcurrentArena::Clear()
+	{
+		// Keep the newest chunk around and free everything else
+		Chunk* current = m_Current.load(std::memory_order_relaxed);
+		FreeChunks(current->Prev);
+		FreeChunks(m_LargeChunks.exchange(nullptr, std::memory_order_relaxed));
+
+		current->Prev = nullptr;
+		current->Offset.store(0, std::memory_order_relaxed);
+	}
+
+	ConcurrentArena::Chunk* ConcurrentArena::AllocateChunk(size_t size)
+	{
+		void* buffer = ::operator new(sizeof(Chunk) + size, std::align_val_t(alignof(Chunk)));
+		Chunk* chunk = new(buffer) Chunk();
+		chunk->Offset.store(0, std::memory_order_relaxed);
+		chunk->Size = size;
+		chunk->Prev = nullptr;
+		return chunk;
+	}
+
+	void ConcurrentArena::FreeChunks(Chunk* chunk)
+	{
+		while (chunk != nullptr)
+		{
+			Chunk* prev = chunk->Prev;
+			chunk->~Chunk();
+			::operator delete(chunk, std::align_val_t(alignof(Chunk)));
+			chunk = prev;
+		}
+	}
+}
@@ -0,0 +1,219 @@
+#include "Arrowhead/ConcurrentGarbageHeap.h"
+
+#include <algorithm>
+
+namespace arwh
+{
+	std::atomic<uint64_t> ConcurrentGarbageHeap::s_NextId = 1;
+
+	// The heaps each thread has used lately, keyed by the id of the ConcurrentGarbageHeap that
+	// owns them. Ids are never reused so an entry for a destroyed heap just never matches again.
+	// A thread only takes the lock when it uses a heap for the first time or when it goes
+	// through more than EntryCount of them and the oldest entry got pushed out
+	struct ThreadHeapCache
+	{
+		static constexpr uint32_t EntryCount = 8;
+
+		struct Entry
+		{
+			uint64_t Owner = 0;
+			GarbageHeap* Heap = nullptr;
+		};
+
+		Entry Entries[EntryCount];
+		uint32_t Next = 0;
+
+		GarbageHeap* Find(uint64_t owner) const
+		{
+			for (const Entry& entry : Entries)
+			{
+				if (entry.Owner == owner)
+					return entry.Heap;
+			}
+			return nullptr;
+		}
+
+		void Add(uint64_t owner, GarbageHeap* heap)
+		{
+			Entries[Next] = { owner, heap };
+			Next = (Next + 1) % EntryCount;
+		}
+	};
+
+	thread_local ThreadHeapCache t_HeapCache;
+
+	ConcurrentGarbageHeap::ConcurrentGarbageHeap(size_t heapSize, uint32_t workerCount, size_t parallelThreshold)
+		: m_HeapSize(heapSize), m_ParallelThreshold(parallelThreshold), m_Id(s_NextId.fetch_add(1, std::memory_order_relaxed)),
+		m_WorkerCount(workerCount) {}
+
+	ConcurrentGarbageHeap::~ConcurrentGarbageHeap()
+	{
+		CleanupGarbage();
+
+		{
+			std::lock_guard<std::mutex> lock(m_WorkMutex);
+			m_Stopping = true;
+		}
+		m_WorkReady.notify_all();
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	GarbageHeap* ConcurrentGarbageHeap::GetThreadHeap()
+	{
+		if (GarbageHeap* cached = t_HeapCache.Find(m_Id))
+			return cached;
+
+		std::lock_guard<std::mutex> lock(m_HeapMutex);
+		std::thread::id thread = std::this_thread::get_id();
+
+		GarbageHeap* heap = nullptr;
+		for (auto& [id, threadHeap] : m_Heaps)
+		{
+			if (id == thread)
+			{
+				heap = threadHeap.get();
+				break;
+			}
+		}
+
+		if (!heap)
+		{
+			m_Heaps.emplace_back(thread, std::make_unique<GarbageHeap>(m_HeapSize));
+			heap = m_Heaps.back().second.get();
+		}
+
+		t_HeapCache.Add(m_Id, heap);
+		return heap;
+	}
+
+	void ConcurrentGarbageHeap::CleanupGarbage()
+	{
+		std::lock_guard<std::mutex> lock(m_HeapMutex);
+
+		size_t count = 0;
+		for (auto& [id, heap] : m_Heaps)
+			for (uint32_t i = 0; i < heap->m_NumRecords; i++)
+				count += heap->m_Records[i].Count;
+
+		if (count < m_ParallelThreshold || m_WorkerCount == 0)
+		{
+			for (auto& [id, heap] : m_Heaps)
+				heap->CleanupGarbage();
+			return;
+		}
+
+		// Cut the runs into pieces that are small enough to spread evenly over the workers
+		m_Pieces.clear();
+		for (auto& [id, heap] : m_Heaps)
+		{
+			for (uint32_t i = 0; i < heap->m_NumRecords; i++)
+			{
+				const GarbageHeap::DestructorRecord& record = heap->m_Records[i];
+				for (size_t offset = 0; offset < record.Count; offset += PieceSize)
+				{
+					void* objects = static_cast<char*>(record.Objects) + offset * record.ObjectSize;
+					m_Pieces.push_back({ record.Destroy, objects, std::min(PieceSize, record.Count - offset), record.ObjectSize });
+				}
+			}
+		}
+
+		// Same grouping GarbageHeap does on its own, but across every thread's heap
+		std::stable_sort(m_Pieces.begin(), m_Pieces.end(), [](const GarbageHeap::DestructorRecord& a, const GarbageHeap::DestructorRecord& b)
+		{
+			return reinterpret_cast<uintptr_t>(a.Destroy) < reinterpret_cast<uintptr_t>(b.Destroy);
+		});
+
+		if (m_Workers.empty())
+			StartWorkers();
+
+		{
+			std::lock_guard<std::mutex> workLock(m_WorkMutex);
+			m_NextPiece.store(0, std::memory_order_relaxed);
+			m_BusyWorkers = m_WorkerCount;
+			m_Job++;
+		}
+		m_WorkReady.notify_all();
+
+		// Help out instead of just waiting
+		DestroyPieces();
+
+		{
+			std::unique_lock<std::mutex> workLock(m_WorkMutex);
+			m_WorkDone.wait(workLock, [this]() { return m_BusyWorkers == 0; });
+		}
+
+		for (auto& [id, heap] : m_Heaps)
+			heap->ResetBuffer();
+	}
+
+	size_t ConcurrentGarbageHeap::GetUsedSize()
+	{
+		std::lock_guard<std::mutex> lock(m_HeapMutex);
+		size_t size = 0;
+		for (auto& [id, heap] : m_Heaps)
+			size += heap->GetUsedSize();
+		return size;
+	}
+
+	size_t ConcurrentGarbageHeap::GetCapacity()
+	{
+		std::lock_guard<std::mutex> lock(m_HeapMutex);
+		size_t capacity = 0;
+		for (auto& [id, heap] : m_Heaps)
+			capacity += heap->GetCapacity();
+		return capacity;
+	}
+
+	uint32_t ConcurrentGarbageHeap::DefaultWorkerCount()
+	{
+		// The thread calling CleanupGarbage does its share too
+		uint32_t threads = std::thread::hardware_concurrency();
+		return threads > 1 ? threads - 1 : 0;
+	}
+
+	void ConcurrentGarbageHeap::StartWorkers()
+	{
+		m_Workers.reserve(m_WorkerCount);
+		for (uint32_t i = 0; i < m_WorkerCount; i++)
+			m_Workers.emplace_back(&ConcurrentGarbageHeap::WorkerLoop, this);
+	}
+
+	void ConcurrentGarbageHeap::WorkerLoop()
+	{
+		uint64_t lastJob = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_WorkMutex);
+				m_WorkReady.wait(lock, [&]() { return m_Stopping || m_Job != lastJob; });
+				if (m_Stopping)
+					return;
+				lastJob = m_Job;
+			}
+
+			DestroyPieces();
+
+			bool last;
+			{
+				std::lock_guard<std::mutex> lock(m_WorkMutex);
+				last = --m_BusyWorkers == 0;
+			}
+			if (last)
+				m_WorkDone.notify_one();
+		}
+	}
+
+	void ConcurrentGarbageHeap::DestroyPieces()
+	{
+		while (true)
+		{
+			size_t index = m_NextPiece.fetch_add(1, std::memory_order_relaxed);
+			if (index >= m_Pieces.size())
+				return;
+
+			const GarbageHeap::DestructorRecord& piece = m_Pieces[index];
+			piece.Destroy(piece.Objects, piece.Count);
+		}
+	}
+}
@@ -0,0 +1,97 @@
+#include "Arrowhead/EpochGarbageHeap.h"
+
+#include "Arrowhead/Logger.h"
+
+#include <thread>
+
+namespace arwh
+{
+	EpochGarbageHeap::EpochGarbageHeap(size_t heapSize, uint32_t heapCount)
+	{
+		ARWH_CORE_ASSERT(heapCount >= 2, "An epoch garbage heap needs at least two heaps");
+
+		m_Heaps.reserve(heapCount);
+		for (uint32_t i = 0; i < heapCount; i++)
+			m_Heaps.push_back(std::make_unique<GarbageHeap>(heapSize));
+	}
+
+	bool EpochGarbageHeap::TryAdvanceEpoch()
+	{
+		uint64_t epoch = m_Epoch.load(std::memory_order_relaxed);
+
+		uint32_t numSlots = m_NumSlots.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < numSlots; i++)
+		{
+			uint64_t announced = m_Slots[i].Epoch.load();
+			if (announced != Idle && announced != epoch)
+				return false;
+		}
+
+		// Readers are all in the current epoch now, so nobody can still see what was made
+		// in the epoch that used the next heap last
+		m_Epoch.store(epoch + 1);
+		m_Heaps[(epoch + 1) % m_Heaps.size()]->CleanupGarbage();
+		return true;
+	}
+
+	void EpochGarbageHeap::AdvanceEpoch()
+	{
+		while (!TryAdvanceEpoch())
+			std::this_thread::yield();
+	}
+
+	uint32_t EpochGarbageHeap::RegisterThread()
+	{
+		for (uint32_t i = 0; i < MaxThreads; i++)
+		{
+			bool inUse = false;
+			if (m_Slots[i].InUse.compare_exchange_strong(inUse, true, std::memory_order_acquire))
+			{
+				m_Slots[i].Epoch.store(Idle);
+				m_Slots[i].Depth = 0;
+
+				// Bump the number of slots the advancing thread has to look at
+				uint32_t numSlots = m_NumSlots.load(std::memory_order_relaxed);
+				while (numSlots <= i && !m_NumSlots.compare_exchange_weak(numSlots, i + 1, std::memory_order_release)) {}
+				return i;
+			}
+		}
+
+		ARWH_CORE_ASSERT(false, "Too many threads registered with an epoch garbage heap");
+		return MaxThreads;
+	}
+
+	void EpochGarbageHeap::UnregisterThread(uint32_t slot)
+	{
+		m_Slots[slot].Epoch.store(Idle);
+		m_Slots[slot].InUse.store(false, std::memory_order_release);
+	}
+
+	void EpochGarbageHeap::Enter(uint32_t slot)
+	{
+		// Re-announcing from an inner guard would let the epoch move past what the outer one is reading
+		if (m_Slots[slot].Depth++ > 0)
+			return;
+
+		// The epoch can move on between reading and announcing it, so announce again until
+		// the two agree. After that the owner can't get more than one epoch ahead of us
+		uint64_t epoch = m_Epoch.load();
+		while (true)
+		{
+			m_Slots[slot].Epoch.store(epoch);
+			uint64_t current = m_Epoch.load();
+			if (current == epoch)
+				break;
+			epoch = current;
+		}
+	}
+
+	void EpochGarbageHeap::Leave(uint32_t slot)
+	{
+		ARWH_CORE_ASSERT(m_Slots[slot].Depth > 0, "Leaving an epoch that was never entered");
+		if (--m_Slots[slot].Depth > 0)
+			return;
+
+		m_Slots[slot].Epoch.store(Idle, std::memory_order_release);
+	}
+}
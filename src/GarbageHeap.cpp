@@ -1,25 +1,144 @@
 #include "Arrowhead/GarbageHeap.h"
 
+#include "Arrowhead/Logger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
 constexpr size_t PointerBufScale = 512;
+constexpr uint32_t MinRecordCapacity = 16;
 
 namespace arwh
 {
 	GarbageHeap::GarbageHeap(size_t size)
-		: m_Buffer(malloc(size)), m_BufferCursor(m_Buffer), m_Pointers(malloc(size / PointerBufScale)), m_NumPointers(0) {}
+		: m_FirstChunk(AllocateChunk(size)), m_Chunk(m_FirstChunk), m_ChunkSize(size), m_Capacity(size)
+	{
+		m_BufferCursor = m_Chunk->GetData();
+		m_BufferEnd = m_BufferCursor + size;
+
+		m_RecordCapacity = std::max(static_cast<uint32_t>(size / PointerBufScale / sizeof(DestructorRecord)), MinRecordCapacity);
+		m_Records = reinterpret_cast<DestructorRecord*>(malloc(m_RecordCapacity * sizeof(DestructorRecord)));
+		ARWH_CORE_ASSERT(m_Records, "Failed to allocate garbage heap records");
+	}
 
 	GarbageHeap::~GarbageHeap()
 	{
-		free(m_Buffer);
-		free(m_Pointers);
+		CleanupGarbage();
+
+		Chunk* chunk = m_FirstChunk;
+		while (chunk)
+		{
+			Chunk* next = chunk->Next;
+			free(chunk);
+			chunk = next;
+		}
+		free(m_Records);
+	}
+
+	size_t GarbageHeap::GetUsedSize() const
+	{
+		return m_UsedInPrevChunks + static_cast<size_t>(m_BufferCursor - m_Chunk->GetData());
+	}
+
+	void* GarbageHeap::Push(size_t size, size_t alignment)
+	{
+		uintptr_t cursor = reinterpret_cast<uintptr_t>(m_BufferCursor);
+		uintptr_t end = reinterpret_cast<uintptr_t>(m_BufferEnd);
+		uintptr_t block = (cursor + alignment - 1) & ~(alignment - 1);
+		if (block < cursor || block > end || size > end - block)
+		{
+			NextChunk(size + alignment);
+			cursor = reinterpret_cast<uintptr_t>(m_BufferCursor);
+			block = (cursor + alignment - 1) & ~(alignment - 1);
+		}
+
+		m_BufferCursor = reinterpret_cast<char*>(block + size);
+		return reinterpret_cast<void*>(block);
+	}
+
+	void GarbageHeap::NextChunk(size_t minSize)
+	{
+		m_UsedInPrevChunks += static_cast<size_t>(m_BufferCursor - m_Chunk->GetData());
+
+		// Reuse the chunk left over from an earlier frame if it's big enough, otherwise
+		// slot a new one in right after the current one
+		Chunk* next = m_Chunk->Next;
+		if (!next || next->Size < minSize)
+		{
+			Chunk* chunk = AllocateChunk(std::max(m_ChunkSize, minSize));
+			chunk->Next = next;
+			m_Chunk->Next = chunk;
+			m_Capacity += chunk->Size;
+			m_NumChunks++;
+			next = chunk;
+		}
+
+		m_Chunk = next;
+		m_BufferCursor = m_Chunk->GetData();
+		m_BufferEnd = m_BufferCursor + m_Chunk->Size;
+	}
+
+	void GarbageHeap::AddDestructor(void (*destroy)(void*, size_t), void* objects, size_t count, size_t objectSize)
+	{
+		// Same type as the last record and directly after it, so just extend that run
+		if (m_NumRecords > 0)
+		{
+			DestructorRecord& last = m_Records[m_NumRecords - 1];
+			if (last.Destroy == destroy && reinterpret_cast<char*>(last.Objects) + last.Count * objectSize == objects)
+			{
+				last.Count += count;
+				return;
+			}
+		}
+
+		// Nothing points into the records so the table can just be moved when it's full
+		if (m_NumRecords == m_RecordCapacity)
+		{
+			m_RecordCapacity *= 2;
+			m_Records = reinterpret_cast<DestructorRecord*>(realloc(m_Records, m_RecordCapacity * sizeof(DestructorRecord)));
+			ARWH_CORE_ASSERT(m_Records, "Failed to grow garbage heap records");
+		}
+
+		m_Records[m_NumRecords++] = { destroy, objects, count, objectSize };
 	}
 
 	void GarbageHeap::CleanupGarbage()
 	{
-		for (uint32_t i = 0; i < m_NumPointers; i++)
-			reinterpret_cast<BaseGarbagePointer*>(reinterpret_cast<GarbagePointer<void>*>(m_Pointers) + i)->~BaseGarbagePointer();
-		m_BufferCursor = m_Buffer;
-		m_NumPointers = 0;
+		SortRecords();
+		for (uint32_t i = 0; i < m_NumRecords; i++)
+			m_Records[i].Destroy(m_Records[i].Objects, m_Records[i].Count);
+		ResetBuffer();
+	}
+
+	void GarbageHeap::SortRecords()
+	{
+		// Types that were allocated interleaved only merge with their direct neighbours, so
+		// group every record of a type together and each destructor runs back to back.
+		// Stable so objects of one type still go in the order they were allocated
+		std::stable_sort(m_Records, m_Records + m_NumRecords, [](const DestructorRecord& a, const DestructorRecord& b)
+		{
+			return reinterpret_cast<uintptr_t>(a.Destroy) < reinterpret_cast<uintptr_t>(b.Destroy);
+		});
+	}
+
+	void GarbageHeap::ResetBuffer()
+	{
+		m_NumRecords = 0;
+		m_Chunk = m_FirstChunk;
+		m_BufferCursor = m_Chunk->GetData();
+		m_BufferEnd = m_BufferCursor + m_Chunk->Size;
+		m_UsedInPrevChunks = 0;
 		// The data stored in both of the buffers doesn't actually need to be 
 		// cleared because it will just be overwritten
 	}
+
+	GarbageHeap::Chunk* GarbageHeap::AllocateChunk(size_t size)
+	{
+		Chunk* chunk = reinterpret_cast<Chunk*>(malloc(sizeof(Chunk) + size));
+		ARWH_CORE_ASSERT(chunk, "Failed to allocate garbage heap chunk");
+		chunk->Next = nullptr;
+		chunk->Size = size;
+		return chunk;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "VirtualMemory.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+namespace arwh::VirtualMemory
+{
+    size_t GetPageSize()
+    {
+        static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return pageSize;
+    }
+
+    void* Reserve(size_t size)
+    {
+        void* address = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return address == MAP_FAILED ? nullptr : address;
+    }
+
+    bool Commit(void* address, size_t size)
+    {
+        return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+    }
+
+    void Decommit(void* address, size_t size)
+    {
+        // Mapping over the range drops the pages and leaves it inaccessible again
+        mmap(address, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    }
+
+    void Release(void* address, size_t size)
+    {
+        munmap(address, size);
+    }
+
+    size_t GetHugePageSize()
+    {
+        static const size_t hugePageSize = []()
+        {
+            // The default huge page size is only exposed through meminfo
+            std::ifstream meminfo("/proc/meminfo");
+            std::string key;
+            size_t value;
+            while (meminfo >> key >> value)
+            {
+                if (key == "Hugepagesize:")
+                    return value * 1024;
+                meminfo.ignore(256, '\n');
+            }
+            return static_cast<size_t>(2 * 1024 * 1024);
+        }();
+        return hugePageSize;
+    }
+
+    void* AllocateHuge(size_t size)
+    {
+        void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        return address == MAP_FAILED ? nullptr : address;
+    }
+
+    bool AdviseHugePages(void* address, size_t size)
+    {
+        return madvise(address, size, MADV_HUGEPAGE) == 0;
+    }
+
+    const void* MapFile(const char* path, size_t* size)
+    {
+        int file = open(path, O_RDONLY);
+        if (file < 0)
+            return nullptr;
+
+        struct stat info;
+        if (fstat(file, &info) != 0 || info.st_size == 0)
+        {
+            close(file);
+            return nullptr;
+        }
+
+        // The mapping keeps the file alive so the descriptor isn't needed afterwards
+        void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (address == MAP_FAILED)
+            return nullptr;
+
+        *size = static_cast<size_t>(info.st_size);
+        return address;
+    }
+
+    void UnmapFile(const void* address, size_t size)
+    {
+        munmap(const_cast<void*>(address), size);
+    }
+}
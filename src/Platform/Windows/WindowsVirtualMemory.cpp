@@ -0,0 +1,84 @@
+#include "VirtualMemory.h"
+
+#include <Windows.h>
+
+namespace arwh::VirtualMemory
+{
+	size_t GetPageSize()
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return static_cast<size_t>(info.dwPageSize);
+	}
+
+	void* Reserve(size_t size)
+	{
+		return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+	}
+
+	bool Commit(void* address, size_t size)
+	{
+		return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+	}
+
+	void Decommit(void* address, size_t size)
+	{
+		VirtualFree(address, size, MEM_DECOMMIT);
+	}
+
+	void Release(void* address, size_t)
+	{
+		VirtualFree(address, 0, MEM_RELEASE);
+	}
+
+	size_t GetHugePageSize()
+	{
+		size_t largePageSize = GetLargePageMinimum();
+		return largePageSize != 0 ? largePageSize : 2 * 1024 * 1024;
+	}
+
+	void* AllocateHuge(size_t size)
+	{
+		// This fails unless the process has been granted SeLockMemoryPrivilege
+		return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	}
+
+	bool AdviseHugePages(void*, size_t)
+	{
+		// Windows doesn't have transparent huge pages, large pages have to be asked for up front
+		return false;
+	}
+
+	const void* MapFile(const char* path, size_t* size)
+	{
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return nullptr;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		// The view keeps the mapping and the file alive so both handles can be closed
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (mapping == nullptr)
+			return nullptr;
+
+		const void* address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (address == nullptr)
+			return nullptr;
+
+		*size = static_cast<size_t>(fileSize.QuadPart);
+		return address;
+	}
+
+	void UnmapFile(const void* address, size_t)
+	{
+		UnmapViewOfFile(address);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "Arrowhead/Ref.h"
+
+#include <mutex>
+#include <vector>
+
+namespace arwh
+{
+	struct HeapRefDeleter : RefDeleter
+	{
+		constexpr HeapRefDeleter()
+			: RefDeleter(&FreeBlock) {}
+
+		static void FreeBlock(RefDeleter* deleter, void* block);
+	};
+
+	// One for every power of two alignment, indexed by its log2
+	static HeapRefDeleter s_HeapDeleters[sizeof(size_t) * 8];
+
+	void HeapRefDeleter::FreeBlock(RefDeleter* deleter, void* block)
+	{
+		size_t alignment = static_cast<size_t>(1) << (static_cast<HeapRefDeleter*>(deleter) - s_HeapDeleters);
+		::operator delete(block, std::align_val_t(alignment));
+	}
+
+	RefDeleter* RefBlock::GetHeapDeleter(size_t alignment)
+	{
+		uint32_t index = 0;
+		while ((static_cast<size_t>(1) << index) < alignment)
+			index++;
+		return &s_HeapDeleters[index];
+	}
+
+	// Blocks whose object hasn't got to its BasicRefCount constructor yet. Usually there's at
+	// most one, more only when a base class that comes before it makes refcounted objects itself
+	struct PendingRefBlock
+	{
+		RefControlBase* Control;
+		const uint8_t* Object;
+		const uint8_t* End;
+	};
+
+	thread_local std::vector<PendingRefBlock> t_PendingBlocks;
+
+	void RefBlock::PushPending(RefControlBase* control, const void* object, size_t size)
+	{
+		const uint8_t* start = static_cast<const uint8_t*>(object);
+		t_PendingBlocks.push_back({ control, start, start + size });
+	}
+
+	RefControlBase* RefBlock::TakePending(const void* subobject)
+	{
+		// Anything else, like an object on the stack made while another one is being newed
+		// up, has no block and leaves the pending one alone
+		const uint8_t* address = static_cast<const uint8_t*>(subobject);
+		if (t_PendingBlocks.empty() || address < t_PendingBlocks.back().Object || address >= t_PendingBlocks.back().End)
+			return nullptr;
+
+		RefControlBase* control = t_PendingBlocks.back().Control;
+		t_PendingBlocks.pop_back();
+		return control;
+	}
+
+	void RefBlock::CancelPending(RefControlBase* control)
+	{
+		if (!t_PendingBlocks.empty() && t_PendingBlocks.back().Control == control)
+			t_PendingBlocks.pop_back();
+	}
+
+	// Objects other threads dropped below zero while this thread still owned them. Sticks
+	// around after its thread exits until every object it owned has been merged
+	class BiasedRefQueue
+	{
+	public:
+		static BiasedRefQueue* GetCurrent();
+
+		void AddObject() { m_Refs.fetch_add(1, std::memory_order_relaxed); }
+
+		void ReleaseObject()
+		{
+			if (m_Refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				delete this;
+		}
+
+		// Returns true when the object should be deleted by the caller
+		bool Enqueue(const BiasedRefCount* object)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (!m_Orphaned)
+				{
+					m_Pending.push_back(object);
+					return false;
+				}
+			}
+
+			// Nobody is left to merge it, and since the owner has exited it's safe to do here.
+			// The object's reference on this queue goes last since it's what keeps it alive
+			bool release = object->Merge(BiasedRefCount::Queued);
+			ReleaseObject();
+			return release;
+		}
+
+		void Process()
+		{
+			std::vector<const BiasedRefCount*> pending;
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				pending.swap(m_Pending);
+			}
+
+			for (const BiasedRefCount* object : pending)
+			{
+				bool release = object->Merge(BiasedRefCount::Queued);
+				ReleaseObject();
+				if (release)
+					BiasedRefCount::Destroy(object);
+			}
+		}
+
+		void Orphan()
+		{
+			while (true)
+			{
+				Process();
+
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (m_Pending.empty())
+				{
+					m_Orphaned = true;
+					break;
+				}
+			}
+
+			BiasedRefCount::s_ThreadQueue = nullptr;
+			ReleaseObject();
+		}
+
+	private:
+		std::mutex m_Mutex;
+		std::vector<const BiasedRefCount*> m_Pending;
+		bool m_Orphaned = false;
+
+		// Objects that still have this as their owner or are waiting in the queue, plus one
+		// for the thread itself
+		std::atomic<uint64_t> m_Refs = 1;
+	};
+
+	struct ThreadQueueHolder
+	{
+		BiasedRefQueue* Queue = nullptr;
+
+		~ThreadQueueHolder()
+		{
+			if (Queue)
+				Queue->Orphan();
+		}
+	};
+
+	thread_local BiasedRefQueue* BiasedRefCount::s_ThreadQueue = nullptr;
+	thread_local ThreadQueueHolder t_QueueHolder;
+
+	BiasedRefQueue* BiasedRefQueue::GetCurrent()
+	{
+		if (!BiasedRefCount::s_ThreadQueue)
+		{
+			BiasedRefCount::s_ThreadQueue = new BiasedRefQueue();
+			t_QueueHolder.Queue = BiasedRefCount::s_ThreadQueue;
+		}
+		return BiasedRefCount::s_ThreadQueue;
+	}
+
+	BasicRefCount<BiasedRefPolicy>::~BasicRefCount()
+	{
+		// Only still set if the object never went through a merge
+		if (BiasedRefQueue* owner = m_Owner.load(std::memory_order_relaxed))
+			owner->ReleaseObject();
+	}
+
+	void BasicRefCount<BiasedRefPolicy>::Destroy(const BasicRefCount* object)
+	{
+		RefDeleter* deleter = object->m_Deleter;
+		if (!deleter)
+		{
+			delete object;
+			return;
+		}
+
+		void* base = const_cast<void*>(dynamic_cast<const void*>(object));
+		object->~BasicRefCount();
+		deleter->Free(deleter, base);
+	}
+
+	uint32_t BasicRefCount<BiasedRefPolicy>::GetRefCount() const
+	{
+		int64_t count = GetCount(m_SharedCount.load());
+		if (IsOwner())
+			count += m_BiasedCount;
+		return count > 0 ? static_cast<uint32_t>(count) : 0;
+	}
+
+	void BasicRefCount<BiasedRefPolicy>::ProcessQueue()
+	{
+		if (s_ThreadQueue)
+			s_ThreadQueue->Process();
+	}
+
+	bool BasicRefCount<BiasedRefPolicy>::Claim() const
+	{
+		BiasedRefQueue* queue = BiasedRefQueue::GetCurrent();
+		BiasedRefQueue* expected = nullptr;
+		if (!m_Owner.compare_exchange_strong(expected, queue))
+			return false;
+
+		// The owner only clears itself after setting Merged, so if the flag isn't set now the
+		// object was never owned and nobody else can merge it while this thread owns it
+		if (m_SharedCount.load() & Merged)
+		{
+			m_Owner.store(nullptr);
+			return false;
+		}
+
+		queue->AddObject();
+		return true;
+	}
+
+	bool BasicRefCount<BiasedRefPolicy>::DecSharedCount() const
+	{
+		// Read before the count changes, the owner only clears it after setting Merged
+		BiasedRefQueue* owner = m_Owner.load();
+
+		int64_t shared = m_SharedCount.load(std::memory_order_relaxed);
+		int64_t next;
+		bool queue;
+		do
+		{
+			next = shared - SharedOne;
+
+			// The owner is still holding references, so it has to be told to merge
+			queue = (shared & (Merged | Queued)) == 0 && GetCount(next) < 0;
+			if (queue)
+				next |= Queued;
+		}
+		while (!m_SharedCount.compare_exchange_weak(shared, next));
+
+		if (queue)
+			return owner->Enqueue(this);
+		return (next & Merged) != 0 && (next & Queued) == 0 && GetCount(next) == 0;
+	}
+
+	bool BasicRefCount<BiasedRefPolicy>::Merge(int64_t clearFlags) const
+	{
+		int64_t delta = -clearFlags;
+
+		BiasedRefQueue* owner = m_Owner.load(std::memory_order_relaxed);
+		if (owner)
+		{
+			delta += static_cast<int64_t>(m_BiasedCount) * SharedOne + Merged;
+			m_BiasedCount = 0;
+		}
+
+		int64_t shared = m_SharedCount.fetch_add(delta) + delta;
+		if (owner)
+		{
+			m_Owner.store(nullptr);
+
+			// A thread that queued the object may still be on its way into Enqueue, so while
+			// it's queued the reference stays and the queue drops it after the queued merge
+			if (clearFlags == 0 && (shared & Queued) == 0)
+				owner->ReleaseObject();
+		}
+
+		// While it's still queued the queue is the one that gets to delete it
+		return (shared & Queued) == 0 && GetCount(shared) == 0;
+	}
+}
\ No newline at end of file
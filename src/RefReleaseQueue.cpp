@@ -0,0 +1,154 @@
+#include "Arrowhead/RefReleaseQueue.h"
+
+#include "Arrowhead/Logger.h"
+
+namespace arwh
+{
+	void RefReleaseQueue::Init(size_t capacity)
+	{
+		ARWH_CORE_ASSERT(!s_Queue, "The ref release queue has already been initialized");
+		s_Queue = new RefReleaseQueue(capacity);
+	}
+
+	void RefReleaseQueue::Dispose()
+	{
+		RefReleaseQueue* queue = s_Queue;
+		if (!queue)
+			return;
+
+		// Nothing can defer anymore by now, so this drain gets everything
+		s_Queue = nullptr;
+		queue->StopReclaimer();
+		while (queue->Drain() > 0 || queue->GetDepth() > 0) {}
+		delete queue;
+	}
+
+	RefReleaseQueue::RefReleaseQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size *= 2;
+
+		m_Cells = new Cell[size];
+		m_Mask = size - 1;
+		for (size_t i = 0; i < size; i++)
+			m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	RefReleaseQueue::~RefReleaseQueue()
+	{
+		delete[] m_Cells;
+	}
+
+	bool RefReleaseQueue::Push(ReleaseFn release, void* object)
+	{
+		size_t pos = m_Tail.load(std::memory_order_relaxed);
+		Cell* cell;
+		while (true)
+		{
+			cell = &m_Cells[pos & m_Mask];
+			size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+			if (diff == 0)
+			{
+				if (m_Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				// The consumer hasn't got to this cell since the last lap, so the ring is full
+				m_Overflowed.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+				pos = m_Tail.load(std::memory_order_relaxed);
+		}
+
+		cell->Release = release;
+		cell->Object = object;
+		cell->Sequence.store(pos + 1, std::memory_order_release);
+
+		m_Deferred.fetch_add(1, std::memory_order_relaxed);
+		// The drainer may already be past this cell by now, which would wrap the difference
+		size_t head = m_Head.load(std::memory_order_relaxed);
+		size_t depth = pos + 1 > head ? pos + 1 - head : 0;
+		size_t peak = m_PeakDepth.load(std::memory_order_relaxed);
+		while (depth > peak && !m_PeakDepth.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {}
+		return true;
+	}
+
+	size_t RefReleaseQueue::Drain(size_t maxCount)
+	{
+		std::unique_lock<std::mutex> lock(m_DrainMutex, std::try_to_lock);
+		if (!lock.owns_lock())
+			return 0;
+
+		size_t count = 0;
+		size_t pos = m_Head.load(std::memory_order_relaxed);
+		while (count < maxCount)
+		{
+			Cell& cell = m_Cells[pos & m_Mask];
+
+			// Either empty or a producer is still in the middle of writing this one
+			if (cell.Sequence.load(std::memory_order_acquire) != pos + 1)
+				break;
+
+			ReleaseFn release = cell.Release;
+			void* object = cell.Object;
+
+			// Hand the cell back before releasing so the destructor can defer more objects
+			cell.Sequence.store(pos + m_Mask + 1, std::memory_order_release);
+			m_Head.store(++pos, std::memory_order_relaxed);
+
+			release(object);
+			count++;
+		}
+
+		m_Released.fetch_add(count, std::memory_order_relaxed);
+		return count;
+	}
+
+	void RefReleaseQueue::StartReclaimer(std::chrono::milliseconds interval)
+	{
+		ARWH_CORE_ASSERT(!m_Reclaimer.joinable(), "The ref release reclaimer is already running");
+		m_StopReclaimer = false;
+		m_Reclaimer = std::thread(&RefReleaseQueue::ReclaimerLoop, this, interval);
+	}
+
+	void RefReleaseQueue::StopReclaimer()
+	{
+		if (!m_Reclaimer.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_ReclaimerMutex);
+			m_StopReclaimer = true;
+		}
+		m_ReclaimerWake.notify_one();
+		m_Reclaimer.join();
+	}
+
+	RefReleaseStats RefReleaseQueue::GetStats() const
+	{
+		RefReleaseStats stats;
+		stats.Depth = GetDepth();
+		stats.PeakDepth = m_PeakDepth.load(std::memory_order_relaxed);
+		stats.Deferred = m_Deferred.load(std::memory_order_relaxed);
+		stats.Released = m_Released.load(std::memory_order_relaxed);
+		stats.Overflowed = m_Overflowed.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void RefReleaseQueue::ReclaimerLoop(std::chrono::milliseconds interval)
+	{
+		std::unique_lock<std::mutex> lock(m_ReclaimerMutex);
+		while (!m_StopReclaimer)
+		{
+			lock.unlock();
+			Drain();
+			lock.lock();
+
+			m_ReclaimerWake.wait_for(lock, interval, [this]() { return m_StopReclaimer; });
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "Arrowhead/SizeClassAllocator.h"
+
+#include "Arrowhead/Logger.h"
+
+#include <algorithm>
+
+namespace arwh
+{
+	static inline uint32_t FloorLog2(size_t value)
+	{
+		uint32_t log = 0;
+		while (value >>= 1)
+			log++;
+		return log;
+	}
+
+	SizeClassAllocator::SizeClassAllocator(Arena* arena, size_t slabSize)
+		: m_Arena(arena), m_SlabSize(slabSize)
+	{
+		Reset();
+	}
+
+	void* SizeClassAllocator::Allocate(size_t size, size_t alignment)
+	{
+		if (size > MaxSize || alignment > MaxSize)
+			return m_Arena->PushAligned(size, alignment);
+
+		size_t index = GetClassIndex(size, alignment);
+		SizeClass& sizeClass = m_Classes[index];
+
+		// Reuse a freed block first, then carve from the current slab
+		if (FreeBlock* block = sizeClass.FirstFree)
+		{
+			sizeClass.FirstFree = block->Next;
+			return block;
+		}
+
+		size_t classSize = GetClassSize(index);
+		if (classSize <= static_cast<size_t>(sizeClass.End - sizeClass.Cursor))
+		{
+			void* block = sizeClass.Cursor;
+			sizeClass.Cursor += classSize;
+			return block;
+		}
+
+		return AllocateSlow(sizeClass, index);
+	}
+
+	void SizeClassAllocator::Free(void* block, size_t size, size_t alignment)
+	{
+		if (block == nullptr)
+			return;
+
+		if (size > MaxSize || alignment > MaxSize)
+		{
+			if (m_Arena->IsLast(block, size))
+				m_Arena->Pop(size);
+			return;
+		}
+
+		SizeClass& sizeClass = m_Classes[GetClassIndex(size, alignment)];
+		FreeBlock* freeBlock = reinterpret_cast<FreeBlock*>(block);
+		freeBlock->Next = sizeClass.FirstFree;
+		sizeClass.FirstFree = freeBlock;
+	}
+
+	void SizeClassAllocator::Reset()
+	{
+		for (SizeClass& sizeClass : m_Classes)
+			sizeClass = SizeClass();
+	}
+
+	size_t SizeClassAllocator::GetClassIndex(size_t size)
+	{
+		// Multiples of 16 up to 64 and then four steps for every power of two after that
+		if (size <= 64)
+			return size == 0 ? 0 : (size - 1) / 16;
+
+		uint32_t log = FloorLog2(size - 1);
+		return 4 + (log - 6) * 4 + (((size - 1) - (size_t(1) << log)) >> (log - 2));
+	}
+
+	size_t SizeClassAllocator::GetClassSize(size_t index)
+	{
+		if (index < 4)
+			return (index + 1) * 16;
+
+		uint32_t log = 6 + static_cast<uint32_t>(index - 4) / 4;
+		return (size_t(1) << log) + ((index - 4) % 4 + 1) * (size_t(1) << (log - 2));
+	}
+
+	size_t SizeClassAllocator::GetClassIndex(size_t size, size_t alignment) const
+	{
+		// Only power of two classes line up with bigger alignments, so round up to one of those
+		if (alignment > MinAlignment)
+		{
+			size = std::max(size, alignment);
+			size = size_t(1) << (FloorLog2(size - 1) + 1);
+		}
+		return GetClassIndex(size);
+	}
+
+	void* SizeClassAllocator::AllocateSlow(SizeClass& sizeClass, size_t index)
+	{
+		// Align the slab to the biggest power of two that divides the class size so every
+		// object in it ends up aligned to that as well
+		size_t classSize = GetClassSize(index);
+		size_t slabSize = std::max(m_SlabSize, classSize * 8) / classSize * classSize;
+		size_t slabAlignment = classSize & (~classSize + 1);
+
+		uint8_t* slab = reinterpret_cast<uint8_t*>(m_Arena->PushAligned(slabSize, slabAlignment));
+		sizeClass.Cursor = slab + classSize;
+		sizeClass.End = slab + slabSize;
+		return slab;
+	}
+}
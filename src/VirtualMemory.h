@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+namespace arwh::VirtualMemory
+{
+	// Thin wrappers over the platform page APIs. Every address and size passed in
+	// has to be a multiple of the page size
+
+	size_t GetPageSize();
+
+	// Reserves address space without backing it with any memory
+	void* Reserve(size_t size);
+
+	// Makes a reserved range readable and writable, returns false if the system is out of memory
+	bool Commit(void* address, size_t size);
+
+	// Gives the physical memory of a committed range back while keeping the range reserved
+	void Decommit(void* address, size_t size);
+
+	void Release(void* address, size_t size);
+
+	// Huge page support, sizes passed to these have to be a multiple of the huge page size
+
+	size_t GetHugePageSize();
+
+	// Allocates committed memory out of the explicit huge page pool, returns nullptr if
+	// the pool is empty or the process isn't allowed to use it
+	void* AllocateHuge(size_t size);
+
+	// Asks the system to back a range with transparent huge pages, returns false if it can't
+	bool AdviseHugePages(void* address, size_t size);
+
+	// Maps a whole file read only, returns nullptr if it can't be opened or is empty
+	const void* MapFile(const char* path, size_t* size);
+	void UnmapFile(const void* address, size_t size);
+}